@@ -0,0 +1,78 @@
+#ifndef CACHE_SIMULATOR_ACCESS_LOG_H
+#define CACHE_SIMULATOR_ACCESS_LOG_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+
+// Per-access output of the simulator. Rows are formatted into a large buffer and written out in big chunks,
+// instead of flushing the standard output after every access
+class AccessLog {
+public:
+    enum Level {
+        SUMMARY, // Only the Total/Hit/Miss/MissRate block
+        SAMPLE,  // Every Nth access
+        FULL,    // Every access
+    };
+
+    explicit AccessLog(Level level = FULL, long long sampleInterval = 1)
+            : level(level), sampleInterval(sampleInterval), buffer(1 << 20) {}
+
+    AccessLog(const AccessLog &) = delete;
+    AccessLog &operator=(const AccessLog &) = delete;
+
+    ~AccessLog() {
+        flush();
+    }
+
+    // Parse an output level: "full", "summary" or "sample:N". Return false if the format is incorrect
+    static bool parseLevel(const std::string &text, Level &level, long long &sampleInterval) {
+        if (text == "full") {
+            level = FULL;
+        } else if (text == "summary") {
+            level = SUMMARY;
+        } else if (text.compare(0, 7, "sample:") == 0) {
+            level = SAMPLE;
+            sampleInterval = std::strtoll(text.c_str() + 7, nullptr, 10);
+            if (sampleInterval <= 0) return false;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool printsAccesses() const {
+        return level != SUMMARY;
+    }
+
+    // Log the access with the given number (starting from 1)
+    void log(long long number, bool hit, uint64_t memoryAddress, long long memoryBlockIndex, long long setIndex,
+             long long tag) {
+        if (level == SUMMARY || (level == SAMPLE && number % sampleInterval != 0)) return;
+        if (buffer.size() - used < MAX_ROW_LENGTH) flush();
+        used += std::snprintf(&buffer[used], buffer.size() - used, "%5lld %s 0x%08llX -> %10lld -> %5lld -> %10lld\n",
+                              number, hit ? "[Hit!]" : "[Miss]", (unsigned long long) memoryAddress,
+                              memoryBlockIndex, setIndex, tag);
+    }
+
+    // Write the buffered rows to the standard output
+    void flush() {
+        if (used == 0) return;
+        std::fwrite(buffer.data(), 1, used, stdout);
+        std::fflush(stdout);
+        used = 0;
+    }
+
+private:
+    static const size_t MAX_ROW_LENGTH = 128;
+
+    Level level;
+    long long sampleInterval;
+    std::vector<char> buffer;
+    size_t used = 0;
+};
+
+#endif //CACHE_SIMULATOR_ACCESS_LOG_H
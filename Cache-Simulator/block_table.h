@@ -0,0 +1,73 @@
+#ifndef CACHE_SIMULATOR_BLOCK_TABLE_H
+#define CACHE_SIMULATOR_BLOCK_TABLE_H
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+// Open-addressing hash table from memory block indexes (non-negative) to a value, with linear probing
+// One flat array instead of a node per block, so lookups on full-size traces stay cache friendly
+class BlockTable {
+public:
+    BlockTable() : slots(1024) {}
+
+    // Return the value of a block, or nullptr if it is not in the table
+    long long *find(long long memoryBlockIndex) {
+        for (size_t i = slotOf(memoryBlockIndex);; i = (i + 1) & (slots.size() - 1)) {
+            if (slots[i].key == memoryBlockIndex) return &slots[i].value;
+            if (slots[i].key == EMPTY) return nullptr;
+        }
+    }
+
+    // Return the value of a block, inserting the block with the value -1 if it is not in the table
+    long long &insert(long long memoryBlockIndex) {
+        if ((count + 1) * 2 > slots.size()) grow();
+        size_t i = slotOf(memoryBlockIndex);
+        while (slots[i].key != memoryBlockIndex && slots[i].key != EMPTY) i = (i + 1) & (slots.size() - 1);
+        if (slots[i].key == EMPTY) {
+            slots[i].key = memoryBlockIndex;
+            slots[i].value = -1;
+            count++;
+        }
+        return slots[i].value;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Call visit(memoryBlockIndex, value) for every block, in no particular order. The value can be changed
+    template<typename Visitor>
+    void forEach(Visitor visit) {
+        for (Slot &slot: slots) {
+            if (slot.key != EMPTY) visit(slot.key, slot.value);
+        }
+    }
+
+private:
+    static const long long EMPTY = -1;
+
+    struct Slot {
+        long long key = EMPTY;
+        long long value = -1;
+    };
+
+    std::vector<Slot> slots;
+    size_t count = 0;
+
+    size_t slotOf(long long memoryBlockIndex) const {
+        // Fibonacci hashing spreads sequential blocks over the table
+        return (size_t) (((uint64_t) memoryBlockIndex * 0x9E3779B97F4A7C15ull) >> 20) & (slots.size() - 1);
+    }
+
+    void grow() {
+        std::vector<Slot> old(slots.size() * 2);
+        old.swap(slots);
+        count = 0;
+        for (const Slot &slot: old) {
+            if (slot.key != EMPTY) insert(slot.key) = slot.value;
+        }
+    }
+};
+
+#endif //CACHE_SIMULATOR_BLOCK_TABLE_H
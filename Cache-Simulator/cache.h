@@ -0,0 +1,341 @@
+#ifndef CACHE_SIMULATOR_CACHE_H
+#define CACHE_SIMULATOR_CACHE_H
+
+#include <vector>
+#include <cstdint>
+#include <type_traits>
+#include "way_search.h"
+#include "replacement_policy.h"
+
+inline int getCacheBlockIndex(const int setIndex, const int blockIndex, const int setDegree) {
+    return setIndex * setDegree + blockIndex;
+}
+
+// What happens on writes
+struct WritePolicy {
+    bool writeBack = true;     // Write hits only mark the block dirty (otherwise they are sent to the next level)
+    bool writeAllocate = true; // Write misses fetch the block (otherwise the write goes around the cache)
+};
+
+// Size of a cache in KBytes, size of a block in Words (4 Bytes), and the number of blocks in a set
+struct CacheGeometry {
+    int cacheSize = 0;
+    int blockSize = 0;
+    int setDegree = 0;
+
+    int getBlockCount() const {
+        return (int) (((long long) cacheSize * 1024) / (blockSize * 4));
+    }
+
+    int getBlockBytes() const {
+        return blockSize * 4;
+    }
+
+    int getSetCount() const {
+        return getBlockCount() / setDegree;
+    }
+
+    // Return if the block size and the number of sets are powers of two, so addresses can be split with shifts
+    bool isPowerOfTwo() const {
+        return isPowerOfTwo(getBlockBytes()) && isPowerOfTwo(getSetCount());
+    }
+
+    static bool isPowerOfTwo(long long value) {
+        return value > 0 && (value & (value - 1)) == 0;
+    }
+};
+
+inline int log2OfPowerOfTwo(long long value) {
+    int bits = 0;
+    while ((1ll << bits) < value) bits++;
+    return bits;
+}
+
+// Splits byte addresses into memory block indexes, and those into set indexes and tags. All of them are 64-bit
+// The generic version divides, the power-of-two version shifts and masks (see CacheGeometry::isPowerOfTwo())
+template<bool PowerOfTwo>
+class AddressMapping {
+public:
+    explicit AddressMapping(const CacheGeometry &geometry)
+            : blockBytes(geometry.getBlockBytes()), setCount(geometry.getSetCount()) {}
+
+    long long getMemoryBlockIndex(uint64_t memoryAddress) const {
+        return (long long) (memoryAddress / (uint64_t) blockBytes);
+    }
+
+    int getSetIndex(long long memoryBlockIndex) const {
+        return (int) (memoryBlockIndex % setCount);
+    }
+
+    long long getTag(long long memoryBlockIndex) const {
+        return memoryBlockIndex / setCount;
+    }
+
+private:
+    long long blockBytes;
+    long long setCount;
+};
+
+template<>
+class AddressMapping<true> {
+public:
+    explicit AddressMapping(const CacheGeometry &geometry)
+            : blockBits(log2OfPowerOfTwo(geometry.getBlockBytes())), setBits(log2OfPowerOfTwo(geometry.getSetCount())),
+              setMask(((uint64_t) 1 << setBits) - 1) {}
+
+    long long getMemoryBlockIndex(uint64_t memoryAddress) const {
+        return (long long) (memoryAddress >> blockBits);
+    }
+
+    int getSetIndex(long long memoryBlockIndex) const {
+        return (int) ((uint64_t) memoryBlockIndex & setMask);
+    }
+
+    long long getTag(long long memoryBlockIndex) const {
+        return (long long) ((uint64_t) memoryBlockIndex >> setBits);
+    }
+
+private:
+    int blockBits;
+    int setBits;
+    uint64_t setMask;
+};
+
+// Call run(std::true_type()) if the geometry can use the power-of-two address mapping, run(std::false_type()) if not
+template<typename Run>
+void dispatchAddressMapping(const CacheGeometry &geometry, Run run) {
+    if (geometry.isPowerOfTwo()) {
+        run(std::true_type());
+    } else {
+        run(std::false_type());
+    }
+}
+
+// Flags returned by a read/write access
+enum AccessFlags {
+    ACCESS_HIT = 1,            // The block was in the cache
+    ACCESS_FILL = 2,           // The block was fetched from the next level
+    ACCESS_WRITE_BACK = 4,     // A dirty block was replaced and written to the next level
+    ACCESS_WRITE_THROUGH = 8,  // The written word was sent to the next level
+    ACCESS_PREFETCH_HIT = 16,  // First demand access to a prefetched block
+    ACCESS_PREFETCH_DROP = 32, // A prefetched block was replaced before any demand access
+    ACCESS_PREFETCH_LATE = 64, // The prefetch of the block was issued too recently to have arrived
+};
+
+// The blocks of a set-associative cache, the replacement policy is chosen at compile time (see replacement_policy.h)
+// With PowerOfTwo, the geometry must be a power of two and addresses are split with shifts and masks
+// Every access only touches the blocks of its own set, so different sets can be accessed by different threads
+template<typename ReplacementPolicy, bool PowerOfTwo = false>
+class SetAssociativeCache {
+public:
+    // Extra arguments are passed to the constructor of the replacement policy
+    template<typename... PolicyArguments>
+    SetAssociativeCache(const CacheGeometry &geometry, PolicyArguments... policyArguments)
+            : setDegree(geometry.setDegree), setCount(geometry.getSetCount()), mapping(geometry),
+              tags(geometry.getBlockCount(), 0), valid(geometry.getBlockCount(), 0),
+              dirty(geometry.getBlockCount(), 0), prefetchTimes(geometry.getBlockCount(), -1),
+              policy(geometry.getBlockCount(), geometry.setDegree, policyArguments...) {}
+
+    int getSetCount() const {
+        return setCount;
+    }
+
+    int getSetDegree() const {
+        return setDegree;
+    }
+
+    // Prefetched blocks accessed less than this many accesses after their prefetch are reported as late
+    void setPrefetchLatency(int latency) {
+        prefetchLatency = latency;
+    }
+
+    // Get the memory block in which a byte address is located
+    long long getMemoryBlockIndex(uint64_t memoryAddress) const {
+        return mapping.getMemoryBlockIndex(memoryAddress);
+    }
+
+    // Get the set in which a memory block is located
+    int getSetIndex(long long memoryBlockIndex) const {
+        return mapping.getSetIndex(memoryBlockIndex);
+    }
+
+    // Get the tag which identifies a memory block in its set
+    long long getTag(long long memoryBlockIndex) const {
+        return mapping.getTag(memoryBlockIndex);
+    }
+
+    // Access a block in a set, the time is the number of the access in the trace. Return if it's a hit
+    bool access(int setIndex, long long tag, long long time) {
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        int way = findTag(&tags[first], &valid[first], setDegree, tag);
+        if (way != -1) { // Hit
+            policy.onHit(setIndex, way, time);
+            return true;
+        }
+
+        // Miss
+        fill(setIndex, tag, time);
+        return false;
+    }
+
+    // Read or write a block in a set with the given write policy. Return a combination of AccessFlags
+    int access(int setIndex, long long tag, long long time, bool write, const WritePolicy &writePolicy) {
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        int way = findTag(&tags[first], &valid[first], setDegree, tag);
+        int flags;
+        if (way != -1) { // Hit
+            policy.onHit(setIndex, way, time);
+            flags = ACCESS_HIT;
+            if (prefetchTimes[first + way] >= 0) {
+                flags |= ACCESS_PREFETCH_HIT;
+                if (time - prefetchTimes[first + way] < prefetchLatency) flags |= ACCESS_PREFETCH_LATE;
+                prefetchTimes[first + way] = -1;
+            }
+        } else if (write && !writePolicy.writeAllocate) { // Write miss without allocation
+            return ACCESS_WRITE_THROUGH;
+        } else { // Miss
+            Replacement replacement = fill(setIndex, tag, time);
+            way = replacement.way;
+            flags = ACCESS_FILL | replacementFlags(replacement);
+        }
+        if (write) {
+            if (writePolicy.writeBack) {
+                dirty[first + way] = 1;
+            } else {
+                flags |= ACCESS_WRITE_THROUGH;
+            }
+        }
+        return flags;
+    }
+
+    // Hint the CPU to load the tags and valid flags of a set, before a later access to it
+    void prefetchSet(int setIndex) const {
+#if defined(__GNUC__)
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        __builtin_prefetch(&tags[first]);
+        __builtin_prefetch(&valid[first]);
+#else
+        (void) setIndex;
+#endif
+    }
+
+    // Return if a memory block is in the cache, without touching the replacement state
+    bool contains(long long memoryBlockIndex) const {
+        int first = getCacheBlockIndex(getSetIndex(memoryBlockIndex), 0, setDegree);
+        return findTag(&tags[first], &valid[first], setDegree, getTag(memoryBlockIndex)) != -1;
+    }
+
+    // Look up a memory block. Unlike access(), a miss does not insert the block. Return if it's a hit
+    bool lookup(long long memoryBlockIndex, long long time) {
+        int setIndex = getSetIndex(memoryBlockIndex);
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        int way = findTag(&tags[first], &valid[first], setDegree, getTag(memoryBlockIndex));
+        if (way == -1) return false;
+        policy.onHit(setIndex, way, time);
+        return true;
+    }
+
+    // Insert a memory block which is not in the cache. Return the memory block index of the replaced block, or -1
+    long long insert(long long memoryBlockIndex, long long time) {
+        bool replacedDirty;
+        return insert(memoryBlockIndex, time, false, replacedDirty);
+    }
+
+    // Same as above, the new block can be dirty. Also return if the replaced block was dirty
+    long long insert(long long memoryBlockIndex, long long time, bool dirtyBlock, bool &replacedDirty) {
+        int setIndex = getSetIndex(memoryBlockIndex);
+        Replacement replacement = fill(setIndex, getTag(memoryBlockIndex), time);
+        dirty[getCacheBlockIndex(setIndex, replacement.way, setDegree)] = dirtyBlock;
+        replacedDirty = replacement.dirty;
+        if (!replacement.replaced) return -1;
+        return replacement.tag * setCount + setIndex;
+    }
+
+    // Bring a memory block in for a prefetcher, unless it is already in the cache
+    // Return 0 if nothing was fetched, otherwise ACCESS_FILL combined with the flags of the replaced block
+    int prefetch(long long memoryBlockIndex, long long time) {
+        int setIndex = getSetIndex(memoryBlockIndex);
+        long long tag = getTag(memoryBlockIndex);
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        if (findTag(&tags[first], &valid[first], setDegree, tag) != -1) return 0;
+        Replacement replacement = fill(setIndex, tag, time);
+        prefetchTimes[first + replacement.way] = time;
+        return ACCESS_FILL | replacementFlags(replacement);
+    }
+
+    // Mark a memory block dirty. Return if it was in the cache
+    bool markDirty(long long memoryBlockIndex) {
+        int first = getCacheBlockIndex(getSetIndex(memoryBlockIndex), 0, setDegree);
+        int way = findTag(&tags[first], &valid[first], setDegree, getTag(memoryBlockIndex));
+        if (way == -1) return false;
+        dirty[first + way] = 1;
+        return true;
+    }
+
+    // Remove a memory block from the cache. Return if it was in the cache
+    bool invalidate(long long memoryBlockIndex) {
+        bool wasDirty;
+        return invalidate(memoryBlockIndex, wasDirty);
+    }
+
+    // Same as above, also return if the removed block was dirty
+    bool invalidate(long long memoryBlockIndex, bool &wasDirty) {
+        int first = getCacheBlockIndex(getSetIndex(memoryBlockIndex), 0, setDegree);
+        int way = findTag(&tags[first], &valid[first], setDegree, getTag(memoryBlockIndex));
+        wasDirty = false;
+        if (way == -1) return false;
+        valid[first + way] = 0;
+        wasDirty = dirty[first + way] != 0;
+        dirty[first + way] = 0;
+        prefetchTimes[first + way] = -1;
+        return true;
+    }
+
+private:
+    struct Replacement {
+        int way = 0;
+        bool replaced = false; // A valid block was replaced
+        bool dirty = false;    // The replaced block was dirty
+        bool unused = false;   // The replaced block was prefetched and never accessed
+        long long tag = 0;     // Tag of the replaced block
+    };
+
+    int setDegree;
+    int setCount;
+    AddressMapping<PowerOfTwo> mapping;
+    // The blocks are stored as separate arrays (structure of arrays) so the ways of a set can be searched with SIMD
+    // Valid flags are 0 or -1 (all bits set), so they can be used as masks. Replacement state lives in the policy
+    std::vector<long long> tags;
+    std::vector<int> valid;
+    std::vector<unsigned char> dirty;
+    std::vector<long long> prefetchTimes; // When a prefetcher brought the block in, -1 if it was accessed since
+    int prefetchLatency = 0;
+    ReplacementPolicy policy;
+
+    // Insert a clean block into the first empty block. If there's none, replace the victim of the policy
+    Replacement fill(int setIndex, long long tag, long long time) {
+        int first = getCacheBlockIndex(setIndex, 0, setDegree);
+        Replacement replacement;
+
+        replacement.way = findEmpty(&valid[first], setDegree);
+        if (replacement.way == -1) {
+            replacement.way = policy.findVictim(setIndex, time);
+            replacement.replaced = true;
+            replacement.dirty = dirty[first + replacement.way] != 0;
+            replacement.unused = prefetchTimes[first + replacement.way] >= 0;
+            replacement.tag = tags[first + replacement.way];
+        }
+        valid[first + replacement.way] = -1;
+        tags[first + replacement.way] = tag;
+        dirty[first + replacement.way] = 0;
+        prefetchTimes[first + replacement.way] = -1;
+        policy.onFill(setIndex, replacement.way, time);
+        return replacement;
+    }
+
+    static int replacementFlags(const Replacement &replacement) {
+        return (replacement.dirty ? ACCESS_WRITE_BACK : 0) | (replacement.unused ? ACCESS_PREFETCH_DROP : 0);
+    }
+};
+
+#endif //CACHE_SIMULATOR_CACHE_H
@@ -0,0 +1,114 @@
+#include <stdexcept>
+#include "cache_model.h"
+#include "replacement_policy.h"
+
+// Addresses are looked ahead by this many accesses in a batch, to load their sets before they are needed
+#define BATCH_PREFETCH_DISTANCE 8
+
+class Cache::Model {
+public:
+    virtual ~Model() = default;
+
+    // Return the AccessFlags of the access
+    virtual int access(uint64_t memoryAddress, bool write, long long time) = 0;
+
+    // Access a batch, numbered from time on, and count the accesses into the statistics
+    virtual size_t accessBatch(const uint64_t *memoryAddresses, size_t count, uint64_t *hits,
+                               const unsigned char *writes, long long time, CacheStatistics &statistics) = 0;
+};
+
+// Count an access with its flags
+static void countAccess(CacheStatistics &statistics, int flags, bool write, int blockBytes) {
+    statistics.accessCount++;
+    if (flags & ACCESS_HIT) statistics.hitCount++;
+    if (write) statistics.writeCount++;
+    if (flags & ACCESS_FILL) statistics.fetchedBytes += blockBytes;
+    if (flags & ACCESS_WRITE_BACK) {
+        statistics.writeBackCount++;
+        statistics.writtenBytes += blockBytes;
+    }
+    if (flags & ACCESS_WRITE_THROUGH) statistics.writtenBytes += 4;
+}
+
+namespace {
+
+template<typename ReplacementPolicy, bool PowerOfTwo>
+class PolicyModel final : public Cache::Model {
+public:
+    PolicyModel(const CacheGeometry &geometry, WritePolicy writePolicy)
+            : blockBytes(geometry.getBlockBytes()), writePolicy(writePolicy), cache(geometry) {}
+
+    int access(uint64_t memoryAddress, bool write, long long time) override {
+        long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+        return cache.access(cache.getSetIndex(memoryBlockIndex), cache.getTag(memoryBlockIndex), time, write,
+                            writePolicy);
+    }
+
+    size_t accessBatch(const uint64_t *memoryAddresses, size_t count, uint64_t *hits, const unsigned char *writes,
+                       long long time, CacheStatistics &statistics) override {
+        size_t hitCount = 0;
+        for (size_t i = 0; i < (count + 63) / 64; i++) hits[i] = 0;
+        for (size_t i = 0; i < count; i++) {
+            if (i + BATCH_PREFETCH_DISTANCE < count) {
+                long long aheadBlockIndex = cache.getMemoryBlockIndex(memoryAddresses[i + BATCH_PREFETCH_DISTANCE]);
+                cache.prefetchSet(cache.getSetIndex(aheadBlockIndex));
+            }
+            bool write = writes != nullptr && writes[i];
+            int flags = access(memoryAddresses[i], write, time + (long long) i);
+            countAccess(statistics, flags, write, blockBytes);
+            if (flags & ACCESS_HIT) {
+                hits[i / 64] |= 1ull << (i % 64);
+                hitCount++;
+            }
+        }
+        return hitCount;
+    }
+
+private:
+    int blockBytes;
+    WritePolicy writePolicy;
+    SetAssociativeCache<ReplacementPolicy, PowerOfTwo> cache;
+};
+
+}
+
+std::string Cache::validate(const CacheGeometry &geometry) {
+    if (geometry.cacheSize <= 0 || geometry.blockSize <= 0 || geometry.setDegree <= 0) {
+        return "Cache size, block size and set degree must be positive!";
+    }
+    if (geometry.getBlockCount() / geometry.setDegree <= 0) {
+        return "Set degree cannot be larger than the number of cache blocks";
+    }
+    return "";
+}
+
+bool Cache::isReplacementPolicy(const std::string &policy) {
+    return policy == "lru" || policy == "plru" || policy == "fifo" || policy == "random" || policy == "srrip" ||
+           policy == "brrip";
+}
+
+Cache::Cache(const CacheGeometry &geometry, const std::string &policy, WritePolicy writePolicy)
+        : geometry(geometry) {
+    std::string error = validate(geometry);
+    if (!error.empty()) throw std::invalid_argument(error);
+    if (!isReplacementPolicy(policy)) throw std::invalid_argument("Unknown replacement policy: " + policy);
+    dispatchReplacementPolicy(policy, [&](auto policyType) {
+        dispatchAddressMapping(geometry, [&](auto powerOfTwo) {
+            model.reset(new PolicyModel<typename decltype(policyType)::Type, decltype(powerOfTwo)::value>(
+                    geometry, writePolicy));
+        });
+    });
+}
+
+Cache::~Cache() = default;
+
+bool Cache::access(uint64_t memoryAddress, bool write) {
+    int flags = model->access(memoryAddress, write, statistics.accessCount);
+    countAccess(statistics, flags, write, geometry.getBlockBytes());
+    return (flags & ACCESS_HIT) != 0;
+}
+
+size_t Cache::accessBatch(const uint64_t *memoryAddresses, size_t count, uint64_t *hits,
+                          const unsigned char *writes) {
+    return model->accessBatch(memoryAddresses, count, hits, writes, statistics.accessCount, statistics);
+}
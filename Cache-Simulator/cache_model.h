@@ -0,0 +1,92 @@
+#ifndef CACHE_SIMULATOR_CACHE_MODEL_H
+#define CACHE_SIMULATOR_CACHE_MODEL_H
+
+#include <string>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+#include "cache.h"
+
+// Counters of a Cache
+struct CacheStatistics {
+    long long accessCount = 0;
+    long long hitCount = 0;
+    long long writeCount = 0;
+    long long writeBackCount = 0; // Dirty blocks written to the next level
+    long long fetchedBytes = 0;   // Bytes read from the next level
+    long long writtenBytes = 0;   // Bytes written to the next level
+
+    long long getMissCount() const {
+        return accessCount - hitCount;
+    }
+
+    double getMissRate() const {
+        return accessCount ? (double) getMissCount() / accessCount : 0.0;
+    }
+};
+
+// A set-associative cache which other programs can drive with byte addresses, e.g.:
+//   Cache cache(geometry, "lru");
+//   bool hit = cache.access(0x011C8272);
+// The replacement policy is chosen at run time, but the access loops are compiled for every policy,
+// so a batch of addresses costs one indirect call in total
+class Cache {
+public:
+    // Return an error message if the geometry cannot be built, or an empty string
+    static std::string validate(const CacheGeometry &geometry);
+
+    // Return if the policy is lru, plru, fifo, random, srrip or brrip (the optimal policy needs the whole trace)
+    static bool isReplacementPolicy(const std::string &policy);
+
+    // Throw std::invalid_argument with the message of validate() if the geometry cannot be built,
+    // or if the policy is not one of isReplacementPolicy()
+    explicit Cache(const CacheGeometry &geometry, const std::string &policy = "lru",
+                   WritePolicy writePolicy = WritePolicy());
+    ~Cache();
+
+    Cache(const Cache &) = delete;
+    Cache &operator=(const Cache &) = delete;
+
+    // Read or write a byte address. Return if it's a hit
+    bool access(uint64_t memoryAddress, bool write = false);
+
+    // Access count byte addresses in order. Bit i % 64 of hits[i / 64] is set if address i hit,
+    // so hits needs (count + 63) / 64 words. writes[i] marks writes, or all are reads if it's null
+    // Return the number of hits
+    size_t accessBatch(const uint64_t *memoryAddresses, size_t count, uint64_t *hits,
+                       const unsigned char *writes = nullptr);
+
+    const CacheGeometry &getGeometry() const {
+        return geometry;
+    }
+
+    const CacheStatistics &getStatistics() const {
+        return statistics;
+    }
+
+    int getSetCount() const {
+        return geometry.getSetCount();
+    }
+
+    long long getMemoryBlockIndex(uint64_t memoryAddress) const {
+        return (long long) (memoryAddress / (uint64_t) geometry.getBlockBytes());
+    }
+
+    int getSetIndex(uint64_t memoryAddress) const {
+        return (int) (getMemoryBlockIndex(memoryAddress) % getSetCount());
+    }
+
+    long long getTag(uint64_t memoryAddress) const {
+        return getMemoryBlockIndex(memoryAddress) / getSetCount();
+    }
+
+    // The blocks of the chosen replacement policy, see cache_model.cpp
+    class Model;
+
+private:
+    CacheGeometry geometry;
+    CacheStatistics statistics;
+    std::unique_ptr<Model> model;
+};
+
+#endif //CACHE_SIMULATOR_CACHE_MODEL_H
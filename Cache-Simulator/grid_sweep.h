@@ -0,0 +1,199 @@
+#ifndef CACHE_SIMULATOR_GRID_SWEEP_H
+#define CACHE_SIMULATOR_GRID_SWEEP_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <cstdlib>
+#include <cstdint>
+#include "cache_model.h"
+#include "trace.h"
+
+// Runs jobs 0 ... jobCount - 1 on a fixed number of threads. Every thread starts with a contiguous range of jobs
+// and takes them from the back; a thread which runs out steals from the front of the others, so a few slow jobs
+// do not leave the other threads idle
+class WorkStealingPool {
+public:
+    explicit WorkStealingPool(int threadCount) : queues(std::max(1, threadCount)) {}
+
+    // Call job(index) for every index and return when all of them are done. The jobs cannot add more jobs
+    template<typename Job>
+    void run(int jobCount, Job job) {
+        int threadCount = (int) queues.size();
+        for (int thread = 0; thread < threadCount; thread++) {
+            int first = (int) ((long long) jobCount * thread / threadCount);
+            int last = (int) ((long long) jobCount * (thread + 1) / threadCount);
+            for (int index = first; index < last; index++) queues[thread].jobs.push_back(index);
+        }
+
+        auto work = [&](int thread) {
+            int index;
+            while (takeJob(thread, index)) job(index);
+        };
+        std::vector<std::thread> threads;
+        for (int thread = 1; thread < threadCount; thread++) threads.emplace_back(work, thread);
+        work(0);
+        for (std::thread &thread: threads) thread.join();
+    }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<int> jobs;
+    };
+
+    std::vector<Queue> queues;
+
+    // Take the next job of a thread, or steal one. Return false when no job is left anywhere
+    bool takeJob(int thread, int &index) {
+        {
+            std::lock_guard<std::mutex> lock(queues[thread].mutex);
+            if (!queues[thread].jobs.empty()) {
+                index = queues[thread].jobs.back();
+                queues[thread].jobs.pop_back();
+                return true;
+            }
+        }
+        for (size_t i = 1; i < queues.size(); i++) {
+            Queue &victim = queues[(thread + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.jobs.empty()) {
+                index = victim.jobs.front();
+                victim.jobs.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// Simulate every combination of cache sizes, block sizes, set degrees and replacement policies over one trace,
+// then print one CSV line per cache. The trace is decoded once and shared by all the simulations
+class GridSweep {
+public:
+    // Addresses are simulated in batches of this size, each with its own bitmap of hits
+    static const size_t BATCH_SIZE = 1 << 16;
+
+    struct Configuration {
+        CacheGeometry geometry;
+        std::string policy;
+    };
+
+    // Parse "SIZES:BLOCKS:DEGREES[:POLICIES]", each a comma-separated list. An empty list takes the value of the
+    // default geometry (or the default policy). Geometries which cannot be built are left out
+    // Return false if the format is incorrect or a policy is unknown
+    bool parse(const std::string &text, const CacheGeometry &defaultGeometry, const std::string &defaultPolicy) {
+        std::vector<std::string> fields;
+        for (size_t start = 0, end; start <= text.size(); start = end + 1) {
+            end = std::min(text.find(':', start), text.size());
+            fields.push_back(text.substr(start, end - start));
+        }
+        if (fields.size() < 3 || fields.size() > 4) return false;
+
+        std::vector<int> cacheSizes, blockSizes, setDegrees;
+        std::vector<std::string> policies;
+        if (!parseNumbers(fields[0], defaultGeometry.cacheSize, cacheSizes) ||
+            !parseNumbers(fields[1], defaultGeometry.blockSize, blockSizes) ||
+            !parseNumbers(fields[2], defaultGeometry.setDegree, setDegrees)) {
+            return false;
+        }
+        splitList(fields.size() == 4 && !fields[3].empty() ? fields[3] : defaultPolicy, policies);
+        for (const std::string &policy: policies) {
+            if (!Cache::isReplacementPolicy(policy)) return false;
+        }
+
+        configurations.clear();
+        for (int cacheSize: cacheSizes) {
+            for (int blockSize: blockSizes) {
+                for (int setDegree: setDegrees) {
+                    CacheGeometry geometry;
+                    geometry.cacheSize = cacheSize;
+                    geometry.blockSize = blockSize;
+                    geometry.setDegree = setDegree;
+                    if (!Cache::validate(geometry).empty()) continue;
+                    for (const std::string &policy: policies) configurations.push_back({geometry, policy});
+                }
+            }
+        }
+        return true;
+    }
+
+    const std::vector<Configuration> &getConfigurations() const {
+        return configurations;
+    }
+
+    // Decode the whole trace into memory. Return false if it cannot be opened
+    bool load(const std::string &traceFilePath) {
+        TraceFile traceFile;
+        if (!traceFile.open(traceFilePath)) return false;
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            addresses.push_back(memoryAddress);
+            writes.push_back(write);
+            if (write) hasWrites = true;
+        });
+        return true;
+    }
+
+    // Simulate every configuration on threadCount threads, then print the CSV in the order of the configurations
+    void run(int threadCount, const WritePolicy &writePolicy) {
+        std::vector<CacheStatistics> results(configurations.size());
+        WorkStealingPool pool(threadCount);
+        pool.run((int) configurations.size(), [&](int index) {
+            Cache cache(configurations[index].geometry, configurations[index].policy, writePolicy);
+            std::vector<uint64_t> hits(BATCH_SIZE / 64);
+            for (size_t first = 0; first < addresses.size(); first += BATCH_SIZE) {
+                size_t count = std::min((size_t) BATCH_SIZE, addresses.size() - first);
+                cache.accessBatch(&addresses[first], count, hits.data(), hasWrites ? &writes[first] : nullptr);
+            }
+            results[index] = cache.getStatistics();
+        });
+
+        std::cout << "cache_size,block_size,set_degree,policy,accesses,hits,misses,miss_rate,write_backs,"
+                     "read_bytes,written_bytes\n";
+        for (size_t i = 0; i < configurations.size(); i++) {
+            const CacheGeometry &geometry = configurations[i].geometry;
+            const CacheStatistics &statistics = results[i];
+            std::cout << geometry.cacheSize << "," << geometry.blockSize << "," << geometry.setDegree << ","
+                      << configurations[i].policy << "," << statistics.accessCount << "," << statistics.hitCount
+                      << "," << statistics.getMissCount() << "," << statistics.getMissRate() << ","
+                      << statistics.writeBackCount << "," << statistics.fetchedBytes << ","
+                      << statistics.writtenBytes << "\n";
+        }
+        std::cout.flush();
+    }
+
+private:
+    std::vector<Configuration> configurations;
+    std::vector<uint64_t> addresses;
+    std::vector<unsigned char> writes;
+    bool hasWrites = false;
+
+    static void splitList(const std::string &text, std::vector<std::string> &items) {
+        for (size_t start = 0, end; start <= text.size(); start = end + 1) {
+            end = std::min(text.find(',', start), text.size());
+            items.push_back(text.substr(start, end - start));
+        }
+    }
+
+    static bool parseNumbers(const std::string &text, int defaultValue, std::vector<int> &numbers) {
+        if (text.empty()) {
+            numbers.push_back(defaultValue);
+            return true;
+        }
+        std::vector<std::string> items;
+        splitList(text, items);
+        for (const std::string &item: items) {
+            char *end;
+            long value = std::strtol(item.c_str(), &end, 10);
+            if (item.empty() || *end != '\0' || value <= 0) return false;
+            numbers.push_back((int) value);
+        }
+        return true;
+    }
+};
+
+#endif //CACHE_SIMULATOR_GRID_SWEEP_H
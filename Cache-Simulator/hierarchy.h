@@ -0,0 +1,227 @@
+#ifndef CACHE_SIMULATOR_HIERARCHY_H
+#define CACHE_SIMULATOR_HIERARCHY_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "cache.h"
+
+// How the contents of the levels relate to each other
+enum InclusionPolicy {
+    INCLUSIVE, // Lower levels hold everything the upper levels hold, evictions invalidate the upper levels
+    EXCLUSIVE, // A block is in at most one level, lower levels are filled by the evictions from the level above
+    NINE,      // Non-inclusive non-exclusive: every level is filled on a miss, evictions are independent
+};
+
+// One level of the hierarchy: a set-associative cache with its hit latency and counters
+template<typename ReplacementPolicy>
+struct CacheLevel {
+    CacheGeometry geometry;
+    int hitLatency;
+    SetAssociativeCache<ReplacementPolicy> cache;
+    long long accessCount = 0;
+    long long hitCount = 0;
+    long long writeBackCount = 0; // Dirty blocks written to the level below
+    long long fetchedBytes = 0;   // Bytes read from the level below
+    long long writtenBytes = 0;   // Bytes written to the level below
+
+    CacheLevel(const CacheGeometry &geometry, int hitLatency)
+            : geometry(geometry), hitLatency(hitLatency), cache(geometry) {}
+
+    long long getMemoryBlockIndex(uint64_t memoryAddress) const {
+        return cache.getMemoryBlockIndex(memoryAddress);
+    }
+};
+
+// L1 -> L2 -> ... -> memory. Every level has its own geometry and latency
+template<typename ReplacementPolicy>
+class CacheHierarchy {
+public:
+    // The latencies are the hit latency of each level, followed by the latency of the memory (in cycles)
+    CacheHierarchy(const std::vector<CacheGeometry> &geometries, const std::vector<int> &latencies,
+                   InclusionPolicy inclusionPolicy, WritePolicy writePolicy = WritePolicy())
+            : inclusionPolicy(inclusionPolicy), writePolicy(writePolicy) {
+        levels.reserve(geometries.size());
+        for (size_t i = 0; i < geometries.size(); i++) levels.emplace_back(geometries[i], latencies[i]);
+        memoryLatency = latencies[geometries.size()];
+    }
+
+    // Return an error message if the levels cannot be combined with the inclusion policy, or an empty string
+    static std::string validate(const std::vector<CacheGeometry> &geometries, InclusionPolicy inclusionPolicy) {
+        for (size_t i = 1; i < geometries.size(); i++) {
+            if (inclusionPolicy == EXCLUSIVE && geometries[i].blockSize != geometries[0].blockSize) {
+                return "Exclusive caches must have the same block size on every level!";
+            }
+            if (inclusionPolicy == INCLUSIVE && geometries[i].blockSize < geometries[i - 1].blockSize) {
+                return "Block size of an inclusive cache cannot be smaller than the level above!";
+            }
+        }
+        return "";
+    }
+
+    // Read or write a byte address, the time is the number of the access in the trace
+    // Return the level which had the block (0 = L1), or the number of levels if it came from the memory
+    int access(uint64_t memoryAddress, long long time, bool write = false) {
+        int levelCount = (int) levels.size();
+        int source = levelCount;
+        for (int i = 0; i < levelCount; i++) {
+            levels[i].accessCount++;
+            totalCycles += levels[i].hitLatency;
+            if (levels[i].cache.lookup(levels[i].getMemoryBlockIndex(memoryAddress), time)) {
+                levels[i].hitCount++;
+                source = i;
+                break;
+            }
+        }
+        if (source == levelCount) totalCycles += memoryLatency;
+        accessCount++;
+        if (write) writeCount++;
+
+        if (write && !writePolicy.writeAllocate && source > 0) {
+            // The word goes around the levels which missed, down to the level which has the block
+            for (int i = 0; i < source; i++) levels[i].writtenBytes += WORD_BYTES;
+            if (source < levelCount) {
+                writeWord(source, memoryAddress);
+            } else {
+                memoryWrittenBytes += WORD_BYTES;
+            }
+            return source;
+        }
+
+        if (source > 0) {
+            if (inclusionPolicy == EXCLUSIVE) {
+                // Move the block to L1, and push the victims down one level at a time (all levels share one block size)
+                long long memoryBlockIndex = levels[0].getMemoryBlockIndex(memoryAddress);
+                bool dirtyBlock = false, victimDirty;
+                if (source < levelCount) {
+                    levels[source].cache.invalidate(memoryBlockIndex, dirtyBlock);
+                } else {
+                    memoryReadBytes += levels[0].geometry.getBlockBytes();
+                }
+                // The block crosses every link between the source and L1
+                for (int i = 0; i < source; i++) levels[i].fetchedBytes += levels[i].geometry.getBlockBytes();
+                long long victim = levels[0].cache.insert(memoryBlockIndex, time, dirtyBlock, victimDirty);
+                for (int i = 0; victim != -1; i++) {
+                    int blockBytes = levels[i].geometry.getBlockBytes();
+                    if (victimDirty) levels[i].writeBackCount++;
+                    if (i == levelCount - 1) { // Leaving the last level, only dirty blocks have to be written
+                        if (victimDirty) {
+                            levels[i].writtenBytes += blockBytes;
+                            memoryWrittenBytes += blockBytes;
+                        }
+                        break;
+                    }
+                    levels[i].writtenBytes += blockBytes; // Every victim moves to the level below
+                    bool dirtyVictim = victimDirty;
+                    victim = levels[i + 1].cache.insert(victim, time, dirtyVictim, victimDirty);
+                }
+            } else {
+                // Fill every level above the source, from the bottom up, so back-invalidations never hit the new block
+                if (source == levelCount) memoryReadBytes += levels[levelCount - 1].geometry.getBlockBytes();
+                for (int i = source - 1; i >= 0; i--) {
+                    bool victimDirty;
+                    levels[i].fetchedBytes += levels[i].geometry.getBlockBytes();
+                    long long victim = levels[i].cache.insert(levels[i].getMemoryBlockIndex(memoryAddress), time,
+                                                              false, victimDirty);
+                    if (victim == -1) continue;
+                    if (inclusionPolicy == INCLUSIVE && backInvalidate(i, victim)) victimDirty = true;
+                    if (victimDirty) writeBack(i, victim);
+                }
+            }
+        }
+        if (write) writeWord(0, memoryAddress);
+        return source;
+    }
+
+    // Return if the results include writes or a non-default write policy, so the traffic is worth printing
+    bool hasWriteTraffic() const {
+        return writeCount > 0 || !writePolicy.writeBack || !writePolicy.writeAllocate;
+    }
+
+    void printStatistics() const {
+        for (size_t i = 0; i < levels.size(); i++) {
+            const CacheLevel<ReplacementPolicy> &level = levels[i];
+            std::cout << "L" << i + 1 << ": Access: " << level.accessCount << " / Hit: " << level.hitCount
+                      << " / Miss: " << level.accessCount - level.hitCount << " / HitRate: "
+                      << (level.accessCount ? (double) level.hitCount / level.accessCount : 0.0) << std::endl;
+        }
+        if (inclusionPolicy == INCLUSIVE) std::cout << "BackInvalidations: " << backInvalidationCount << std::endl;
+        std::cout << "AMAT: " << (accessCount ? (double) totalCycles / accessCount : 0.0) << " cycles" << std::endl;
+
+        if (hasWriteTraffic()) {
+            std::cout << "\nRead: " << accessCount - writeCount << " / Write: " << writeCount << std::endl;
+            for (size_t i = 0; i < levels.size(); i++) {
+                const CacheLevel<ReplacementPolicy> &level = levels[i];
+                std::cout << "L" << i + 1 << " <-> " << (i + 1 < levels.size() ? "L" + std::to_string(i + 2) : "Memory")
+                          << ": Fetched: " << level.fetchedBytes << " Bytes / Written: " << level.writtenBytes
+                          << " Bytes / WriteBacks: " << level.writeBackCount << std::endl;
+            }
+            std::cout << "Memory: Read: " << memoryReadBytes << " Bytes / Written: " << memoryWrittenBytes << " Bytes"
+                      << std::endl;
+        }
+    }
+
+private:
+    // Written words are 4 Bytes, the same as the unit of the block size
+    static const int WORD_BYTES = 4;
+
+    std::vector<CacheLevel<ReplacementPolicy>> levels;
+    InclusionPolicy inclusionPolicy;
+    WritePolicy writePolicy;
+    int memoryLatency;
+    long long accessCount = 0;
+    long long writeCount = 0;
+    long long totalCycles = 0;
+    long long backInvalidationCount = 0;
+    long long memoryReadBytes = 0;
+    long long memoryWrittenBytes = 0;
+
+    // Write a word into a level which has its block
+    void writeWord(int levelIndex, uint64_t memoryAddress) {
+        if (writePolicy.writeBack) {
+            levels[levelIndex].cache.markDirty(levels[levelIndex].getMemoryBlockIndex(memoryAddress));
+            return;
+        }
+        // Write-through: the word goes down through every level below, up to the memory
+        for (size_t i = levelIndex; i < levels.size(); i++) levels[i].writtenBytes += WORD_BYTES;
+        memoryWrittenBytes += WORD_BYTES;
+    }
+
+    // A dirty block was replaced in a level. Write it into the first level below which has it, or the memory
+    void writeBack(int levelIndex, long long memoryBlockIndex) {
+        int blockBytes = levels[levelIndex].geometry.getBlockBytes();
+        uint64_t firstByte = (uint64_t) memoryBlockIndex * blockBytes;
+        levels[levelIndex].writeBackCount++;
+        for (size_t i = levelIndex; i < levels.size(); i++) {
+            levels[i].writtenBytes += blockBytes;
+            if (i + 1 < levels.size() && levels[i + 1].cache.markDirty(levels[i + 1].getMemoryBlockIndex(firstByte))) {
+                return;
+            }
+        }
+        memoryWrittenBytes += blockBytes;
+    }
+
+    // A block left an inclusive level, so remove every part of it from the levels above
+    // Return if any of the removed parts was dirty (its data goes out with the replaced block)
+    bool backInvalidate(int levelIndex, long long memoryBlockIndex) {
+        uint64_t firstByte = (uint64_t) memoryBlockIndex * levels[levelIndex].geometry.getBlockBytes();
+        uint64_t lastByte = firstByte + levels[levelIndex].geometry.getBlockBytes() - 1;
+        bool dirty = false;
+        for (int i = levelIndex - 1; i >= 0; i--) {
+            for (long long block = levels[i].getMemoryBlockIndex(firstByte);
+                 block <= levels[i].getMemoryBlockIndex(lastByte); block++) {
+                bool wasDirty;
+                if (levels[i].cache.invalidate(block, wasDirty)) backInvalidationCount++;
+                if (wasDirty) {
+                    levels[i].writeBackCount++;
+                    levels[i].writtenBytes += levels[i].geometry.getBlockBytes();
+                    dirty = true;
+                }
+            }
+        }
+        return dirty;
+    }
+};
+
+#endif //CACHE_SIMULATOR_HIERARCHY_H
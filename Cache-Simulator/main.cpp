@@ -1,118 +1,378 @@
 #include <iostream>
-#include <fstream>
-#include <cmath>
-#include <iomanip>
-
-struct CacheBlock {
-    bool valid = false;
-    int tag = 0;
-    int time = 0;
-};
-
-inline int getCacheBlockIndex(const int setIndex, const int blockIndex, const int setDegree) {
-    return setIndex * setDegree + blockIndex;
+#include <string>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "cache_model.h"
+#include "grid_sweep.h"
+#include "simulation.h"
+
+// Parse "cache_size,block_size,set_degree". Return false if the format is incorrect
+bool parseGeometry(const std::string &text, CacheGeometry &geometry) {
+    char *end;
+    geometry.cacheSize = std::strtol(text.c_str(), &end, 10);
+    if (*end != ',') return false;
+    geometry.blockSize = std::strtol(end + 1, &end, 10);
+    if (*end != ',') return false;
+    geometry.setDegree = std::strtol(end + 1, &end, 10);
+    return *end == '\0' && geometry.cacheSize > 0 && geometry.blockSize > 0 && geometry.setDegree > 0;
 }
 
 int main(int argc, char **argv) {
+    // Split the options (--name or --name=value) from the positional arguments
+    const std::vector<std::string> knownOptions = {"sweep", "output", "threads", "policy", "l2", "l3", "inclusion",
+                                                 "latency", "write-policy", "write-miss",
+                                                 "prefetch", "sample-sets", "sample-time", "validate",
+                                                 "window", "window-format", "classify", "cores", "grid"};
+    std::map<std::string, std::string> options;
+    std::vector<std::string> arguments;
+    for (int i = 1; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument.compare(0, 2, "--") != 0) {
+            arguments.push_back(argument);
+            continue;
+        }
+        size_t separator = argument.find('=');
+        std::string name = argument.substr(2, separator == std::string::npos ? std::string::npos : separator - 2);
+        if (std::find(knownOptions.begin(), knownOptions.end(), name) == knownOptions.end()) {
+            std::cerr << "Unknown option: " << argument << std::endl;
+            exit(1);
+        }
+        options[name] = separator == std::string::npos ? "" : argument.substr(separator + 1);
+    }
+
     // Load the arguments
-    if (argc > 5) {
+    if (arguments.size() > 4) {
         std::cerr << "Too many arguments!" << std::endl;
         exit(1);
-    } else if (argc < 5) {
+    } else if (arguments.size() < 4) {
         std::cerr << "Missing arguments!" << std::endl;
         exit(1);
     }
-    std::string traceFilePath = argv[1];
-    int cacheSize = std::strtol(argv[2], nullptr, 10);
-    int blockSize = std::strtol(argv[3], nullptr, 10);
-    int setDegree = std::strtol(argv[4], nullptr, 10);
+    std::string traceFilePath = arguments[0];
+    int cacheSize = std::strtol(arguments[1].c_str(), nullptr, 10);
+    int blockSize = std::strtol(arguments[2].c_str(), nullptr, 10);
+    int setDegree = std::strtol(arguments[3].c_str(), nullptr, 10);
     if (!cacheSize || !blockSize || !setDegree) {
         std::cerr << "Arguments format incorrect!" << std::endl;
         exit(1);
     }
 
-    // Read the trace file
-    std::fstream traceFile;
-    traceFile.open(traceFilePath, std::ios::in);
-    if (!traceFile) {
+    if (options.count("policy") && options["policy"] != "opt" && !Cache::isReplacementPolicy(options["policy"])) {
+        std::cerr << "Replacement policy must be lru, plru, fifo, random, srrip, brrip or opt!" << std::endl;
+        exit(1);
+    }
+
+    // In sweep mode, the cache size and set degree are the upper bounds of the table
+    if (options.count("sweep")) {
+        if (options.count("policy") && options["policy"] != "lru") {
+            std::cerr << "Sweep mode only supports LRU replacement!" << std::endl;
+            exit(1);
+        }
+        return runSweep(traceFilePath, cacheSize, blockSize, setDegree);
+    }
+
+    // Select how much of the per-access output is printed
+    AccessLog::Level outputLevel = AccessLog::FULL;
+    long long sampleInterval = 1;
+    if (options.count("output") && !AccessLog::parseLevel(options["output"], outputLevel, sampleInterval)) {
+        std::cerr << "Output level must be full, summary or sample:N!" << std::endl;
+        exit(1);
+    }
+
+    // Report the miss rate of every window of N accesses, instead of the per-access output and the final results
+    long long windowSize = 0;
+    WindowReport::Format windowFormat = WindowReport::CSV;
+    if (options.count("window")) {
+        windowSize = std::strtoll(options["window"].c_str(), nullptr, 10);
+        if (windowSize <= 0) {
+            std::cerr << "Window size must be positive!" << std::endl;
+            exit(1);
+        }
+        outputLevel = AccessLog::SUMMARY;
+    }
+    if (options.count("window-format") && !WindowReport::parseFormat(options["window-format"], windowFormat)) {
+        std::cerr << "Window format must be csv or json!" << std::endl;
+        exit(1);
+    }
+    WindowReport windowReport(windowSize, windowFormat);
+    AccessLog accessLog(outputLevel, sampleInterval);
+
+    // The number of threads simulating disjoint sets of the cache
+    int threadCount = 1;
+    if (options.count("threads")) {
+        threadCount = std::strtol(options["threads"].c_str(), nullptr, 10);
+        if (threadCount <= 0) {
+            std::cerr << "Number of threads must be positive!" << std::endl;
+            exit(1);
+        }
+    }
+
+    // Lower cache levels (L2, L3) below the cache given by the arguments (L1)
+    std::vector<CacheGeometry> geometries(1);
+    geometries[0].cacheSize = cacheSize;
+    geometries[0].blockSize = blockSize;
+    geometries[0].setDegree = setDegree;
+    if (options.count("l3") && !options.count("l2")) {
+        std::cerr << "L3 needs an L2 cache!" << std::endl;
+        exit(1);
+    }
+    for (const std::string level: {"l2", "l3"}) {
+        if (!options.count(level)) break;
+        CacheGeometry geometry;
+        if (!parseGeometry(options[level], geometry) || !Cache::validate(geometry).empty()) {
+            std::cerr << "Cache level format must be cache_size,block_size,set_degree!" << std::endl;
+            exit(1);
+        }
+        geometries.push_back(geometry);
+    }
+    InclusionPolicy inclusionPolicy = NINE;
+    if (options.count("inclusion")) {
+        if (options["inclusion"] == "inclusive") {
+            inclusionPolicy = INCLUSIVE;
+        } else if (options["inclusion"] == "exclusive") {
+            inclusionPolicy = EXCLUSIVE;
+        } else if (options["inclusion"] != "nine") {
+            std::cerr << "Inclusion policy must be inclusive, exclusive or nine!" << std::endl;
+            exit(1);
+        }
+    }
+    std::string hierarchyError = CacheHierarchy<LruPolicy>::validate(geometries, inclusionPolicy);
+    if (!hierarchyError.empty()) {
+        std::cerr << hierarchyError << std::endl;
+        exit(1);
+    }
+    if (geometries.size() > 1 && (threadCount > 1 || (options.count("policy") && options["policy"] == "opt"))) {
+        std::cerr << "Cache hierarchies cannot be simulated with threads or the optimal policy!" << std::endl;
+        exit(1);
+    }
+
+    // What happens on writes: write-back or write-through, and whether write misses allocate a block
+    WritePolicy writePolicy;
+    if (options.count("write-policy")) {
+        if (options["write-policy"] == "through") {
+            writePolicy.writeBack = false;
+        } else if (options["write-policy"] != "back") {
+            std::cerr << "Write policy must be back or through!" << std::endl;
+            exit(1);
+        }
+    }
+    if (options.count("write-miss")) {
+        if (options["write-miss"] == "no-allocate") {
+            writePolicy.writeAllocate = false;
+        } else if (options["write-miss"] != "allocate") {
+            std::cerr << "Write miss policy must be allocate or no-allocate!" << std::endl;
+            exit(1);
+        }
+    }
+
+    // Simulate a grid of caches over one decoded copy of the trace, on all the cores unless --threads is given
+    if (options.count("grid")) {
+        for (const std::string other: {"l2", "prefetch", "sample-sets", "sample-time", "window", "classify", "cores"}) {
+            if (!options.count(other)) continue;
+            std::cerr << "Grid sweeps cannot be used with cache hierarchies, prefetchers, sampling, window reports, "
+                         "classification or multicore simulation!" << std::endl;
+            exit(1);
+        }
+        GridSweep grid;
+        if (!grid.parse(options["grid"], geometries[0], options.count("policy") ? options["policy"] : "lru")) {
+            std::cerr << "Grid format must be sizes:block_sizes:set_degrees[:policies] with comma-separated lists "
+                         "of lru, plru, fifo, random, srrip or brrip!" << std::endl;
+            exit(1);
+        }
+        if (grid.getConfigurations().empty()) {
+            std::cerr << "The grid has no cache which can be built!" << std::endl;
+            exit(1);
+        }
+        if (!grid.load(traceFilePath)) {
+            std::cerr << "Cannot open the trace file!" << std::endl;
+            exit(1);
+        }
+        if (!options.count("threads")) threadCount = std::max(1, (int) std::thread::hardware_concurrency());
+        grid.run(threadCount, writePolicy);
+        return 0;
+    }
+
+    // Prefetcher filling extra blocks into the cache
+    std::string prefetcherName = "none";
+    int prefetchDegree = 1;
+    if (options.count("prefetch")) {
+        if (!parsePrefetcher(options["prefetch"], prefetcherName, prefetchDegree)) {
+            std::cerr << "Prefetcher must be none, next-line, stride or stream, optionally followed by :N!"
+                      << std::endl;
+            exit(1);
+        }
+    }
+    if (prefetcherName != "none" && (threadCount > 1 || geometries.size() > 1 ||
+                                     (options.count("policy") && options["policy"] == "opt"))) {
+        std::cerr << "Prefetchers cannot be used with threads, cache hierarchies or the optimal policy!" << std::endl;
+        exit(1);
+    }
+
+    // Sampling: simulate only some of the sets, or periodic windows of the trace
+    int setSampleInterval = 0;
+    long long samplePeriod = 0, sampleWindow = 0, sampleWarmup = 0;
+    if (options.count("sample-sets")) {
+        setSampleInterval = std::strtol(options["sample-sets"].c_str(), nullptr, 10);
+        if (setSampleInterval <= 0) {
+            std::cerr << "Set sampling interval must be positive!" << std::endl;
+            exit(1);
+        }
+    }
+    if (options.count("sample-time") &&
+        !parseTimeSampling(options["sample-time"], samplePeriod, sampleWindow, sampleWarmup)) {
+        std::cerr << "Time sampling format must be period,window[,warmup] with window + warmup <= period!" << std::endl;
+        exit(1);
+    }
+    bool sampling = setSampleInterval > 0 || samplePeriod > 0;
+    if (setSampleInterval > 0 && samplePeriod > 0) {
+        std::cerr << "Set sampling and time sampling cannot be combined!" << std::endl;
+        exit(1);
+    }
+    if (options.count("validate") && !sampling) {
+        std::cerr << "Validation needs a sampling mode!" << std::endl;
+        exit(1);
+    }
+    if (sampling && (threadCount > 1 || geometries.size() > 1 || prefetcherName != "none" ||
+                     (options.count("policy") && options["policy"] == "opt"))) {
+        std::cerr << "Sampling cannot be used with threads, cache hierarchies, prefetchers or the optimal policy!"
+                  << std::endl;
+        exit(1);
+    }
+
+    if (windowSize > 0 && (sampling || geometries.size() > 1)) {
+        std::cerr << "Window reports cannot be used with sampling or cache hierarchies!" << std::endl;
+        exit(1);
+    }
+    if (options.count("classify") && (sampling || geometries.size() > 1 || windowSize > 0)) {
+        std::cerr << "Miss classification cannot be used with sampling, cache hierarchies or window reports!"
+                  << std::endl;
+        exit(1);
+    }
+
+    // More cores, each with its own trace and private cache, kept coherent with the cache of the first trace
+    std::vector<std::string> coreTraceFilePaths = {traceFilePath};
+    if (options.count("cores")) {
+        const std::string &text = options["cores"];
+        for (size_t start = 0, end; start <= text.size(); start = end + 1) {
+            end = std::min(text.find(',', start), text.size());
+            coreTraceFilePaths.push_back(text.substr(start, end - start));
+        }
+        if (std::find(coreTraceFilePaths.begin(), coreTraceFilePaths.end(), "") != coreTraceFilePaths.end()) {
+            std::cerr << "Core traces must be given as file,file,...!" << std::endl;
+            exit(1);
+        }
+        if (sampling || geometries.size() > 1 || prefetcherName != "none" || windowSize > 0 ||
+            options.count("classify") || !writePolicy.writeBack || !writePolicy.writeAllocate ||
+            (options.count("policy") && options["policy"] == "opt")) {
+            std::cerr << "Multicore simulation only supports write-back, write-allocate caches without sampling, "
+                         "hierarchies, prefetchers, window reports, classification or the optimal policy!"
+                      << std::endl;
+            exit(1);
+        }
+    }
+
+    // The standard input can only be read once, but the optimal policy and validation need a second pass
+    bool optimalPolicy = options.count("policy") && options["policy"] == "opt";
+    bool readsStandardInput = std::find(coreTraceFilePaths.begin(), coreTraceFilePaths.end(), "-") !=
+                              coreTraceFilePaths.end();
+    if (readsStandardInput && (optimalPolicy || options.count("validate") || coreTraceFilePaths.size() > 1)) {
+        std::cerr << "The optimal policy, validation and multicore simulation need a trace file instead of the "
+                     "standard input!" << std::endl;
+        exit(1);
+    }
+
+    // Hit latency of every level and the latency of the memory in cycles
+    std::vector<int> latencies = {1, 10, 40};
+    latencies.resize(geometries.size());
+    latencies.push_back(200);
+    if (options.count("latency")) {
+        latencies.clear();
+        const char *text = options["latency"].c_str();
+        for (char *end;; text = end + 1) {
+            latencies.push_back(std::strtol(text, &end, 10));
+            if (*end != ',') break;
+        }
+        if (latencies.size() != geometries.size() + 1) {
+            std::cerr << "Latencies must be given for every cache level and the memory!" << std::endl;
+            exit(1);
+        }
+    }
+
+    // Map the trace file (text or binary) into memory, or stream the standard input
+    TraceFile traceFile;
+    if (!traceFile.open(traceFilePath)) {
         std::cerr << "Cannot open the trace file!" << std::endl;
         exit(1);
     }
 
-    // Count the number of cache blocks. note: 1024 stands for 'K'Byte, 4 stands for 1word = 4bytes
-    int blockCount = (cacheSize * 1024) / (blockSize * 4);
-    // Count the number of sets
+    // Count the number of cache blocks and sets. note: 1024 stands for 'K'Byte, 4 stands for 1word = 4bytes
+    std::string geometryError = Cache::validate(geometries[0]);
+    if (!geometryError.empty()) {
+        std::cerr << geometryError << std::endl;
+        exit(1);
+    }
+    int blockCount = geometries[0].getBlockCount();
     int setCount = blockCount / setDegree;
-    if (setCount <= 0) {
-        std::cerr << "Set degree cannot be larger than the number of cache blocks" << std::endl;
-        exit(1);
-    }
-
-    std::cout << "BlockCount: " << blockCount << "\nSetCount: " << setCount << std::endl << std::endl;
-    std::cout << "No    Status ByteAddr      BlockAddr     Index    Tag" << std::endl;
-    std::cout << "-------------------------------------------------------------" << std::endl;
-
-    // Allocate memory space for the cache
-    auto *cache = new CacheBlock[blockCount];
-
-    // Counters
-    int counter = 0, hitCounter = 0;
-
-    // Read the trace data
-    while (!traceFile.eof()) {
-        char memoryAddress[11];
-        traceFile.getline(memoryAddress, sizeof(memoryAddress));
-        // Get the memory block index in which the address is located
-        int memoryBlockIndex = std::strtol(memoryAddress, nullptr, 16) / (blockSize * 4);
-        int setIndex = memoryBlockIndex % setCount;
-        int tag = floor((double) memoryBlockIndex / setCount);
-
-        // Check if the cache block hit or not
-        bool hit = false;
-        // Find any empty blocks (valid flag = false) and get its index. If not found -> return -1
-        int emptyIndex = -1;
-        // Get the least recently used block in the set
-        // Take first block as initial value, replace blocks if any block has the least counter value
-        int lruIndex = getCacheBlockIndex(setIndex, setDegree - 1, setDegree);
-        // Loop from the back, so that empty block in the front can be used first
-        for (int i = setDegree - 1; i >= 0; i--) {
-            int index = getCacheBlockIndex(setIndex, i, setDegree);
-            if (cache[index].valid && cache[index].tag == tag) { // Hit
-                std::cout << std::setw(5) << counter + 1 << " [Hit!] ";
-                cache[index].time = counter; // Update the timer (LRU)
-                hit = true;
-                hitCounter++;
-                break;
-            }
-            if (!cache[index].valid) { // Find an empty block
-                emptyIndex = index;
-            }
-            if (cache[index].time < cache[lruIndex].time) { // Find LRU block
-                lruIndex = index;
-            }
-        }
-        if (!hit) { // Miss
-            std::cout << std::setw(5) << counter + 1 << " [Miss] ";
-            if (emptyIndex != -1) { // Insert into an empty block
-                cache[emptyIndex].valid = true;
-                cache[emptyIndex].tag = tag;
-                cache[emptyIndex].time = counter;
-            } else { // No empty block -> Remove LRU block then insert new
-                cache[lruIndex].tag = tag;
-                cache[lruIndex].time = counter;
-            }
-        }
-        std::cout << memoryAddress << " -> "
-                  << std::setw(10) << memoryBlockIndex << " -> "
-                  << std::setw(5) << setIndex << " -> "
-                  << std::setw(10) << tag << std::endl;
-        counter++;
-    }
-
-    std::cout << "\nTotal: " << counter << " / Hit: " << hitCounter << " / Miss: " << counter - hitCounter << std::endl;
-    std::cout << "MissRate: " << (double) (counter - hitCounter) / counter << std::endl;
-
-    traceFile.close();
-    delete[] cache;
+
+    // Classify the misses against a fully-associative cache with the same number of blocks
+    MissClassifier missClassifier(options.count("classify") ? blockCount : 0, setCount);
+
+    bool multicore = coreTraceFilePaths.size() > 1;
+    if (accessLog.printsAccesses() && !sampling && !multicore) {
+        std::cout << "BlockCount: " << blockCount << "\nSetCount: " << setCount << std::endl << std::endl;
+        std::cout << "No    Status ByteAddr      BlockAddr     Index    Tag" << std::endl;
+        std::cout << "-------------------------------------------------------------" << std::endl;
+    }
+
+    // Power-of-two geometries split the addresses with shifts and masks instead of divisions
+    std::string policy = options.count("policy") ? options["policy"] : "lru";
+    const CacheGeometry &geometry = geometries[0];
+    if (policy == "opt") {
+        // Look ahead over the whole trace for the next access of every memory block
+        std::vector<long long> memoryBlockIndexes;
+        traceFile.forEachAddress([&](uint64_t memoryAddress) {
+            memoryBlockIndexes.push_back((long long) (memoryAddress / geometry.getBlockBytes()));
+        });
+        std::vector<long long> nextUses = OptimalPolicy::findNextUses(memoryBlockIndexes);
+        NoPrefetcher prefetcher;
+        dispatchAddressMapping(geometry, [&](auto powerOfTwo) {
+            simulate<OptimalPolicy, decltype(powerOfTwo)::value>(traceFile, geometry, threadCount, prefetcher,
+                                                                 writePolicy, accessLog, windowReport, missClassifier,
+                                                                 &nextUses);
+        });
+    } else if (multicore) {
+        dispatchReplacementPolicy(policy, [&](auto policyType) {
+            dispatchAddressMapping(geometry, [&](auto powerOfTwo) {
+                simulateMulticore<typename decltype(policyType)::Type, decltype(powerOfTwo)::value>(
+                        coreTraceFilePaths, geometry, threadCount);
+            });
+        });
+    } else if (sampling) {
+        dispatchReplacementPolicy(policy, [&](auto policyType) {
+            dispatchAddressMapping(geometry, [&](auto powerOfTwo) {
+                simulateSampled<typename decltype(policyType)::Type, decltype(powerOfTwo)::value>(
+                        traceFile, geometry, setSampleInterval, samplePeriod, sampleWindow, sampleWarmup, writePolicy,
+                        options.count("validate"));
+            });
+        });
+    } else if (geometries.size() > 1) {
+        dispatchReplacementPolicy(policy, [&](auto policyType) {
+            simulateHierarchy<typename decltype(policyType)::Type>(traceFile, geometries, latencies, inclusionPolicy,
+                                                                   writePolicy, accessLog);
+        });
+    } else if (threadCount <= 1 && prefetcherName == "none") {
+        simulateWithCache(traceFile, geometry, policy, writePolicy, accessLog, windowReport, missClassifier);
+    } else {
+        dispatchPrefetcher(prefetcherName, prefetchDegree, blockSize, [&](auto &prefetcher) {
+            dispatchReplacementPolicy(policy, [&](auto policyType) {
+                dispatchAddressMapping(geometry, [&](auto powerOfTwo) {
+                    simulate<typename decltype(policyType)::Type, decltype(powerOfTwo)::value>(
+                            traceFile, geometry, threadCount, prefetcher, writePolicy, accessLog, windowReport,
+                            missClassifier);
+                });
+            });
+        });
+    }
     return 0;
 }
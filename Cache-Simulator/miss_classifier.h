@@ -0,0 +1,153 @@
+#ifndef CACHE_SIMULATOR_MISS_CLASSIFIER_H
+#define CACHE_SIMULATOR_MISS_CLASSIFIER_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include "block_table.h"
+
+// Classifies every miss of a cache as compulsory (first access to the block), capacity (a fully-associative
+// LRU cache of the same number of blocks would miss as well) or conflict (it would hit), and builds histograms
+// of the reuse distances and of the misses per set.
+// The fully-associative cache is not simulated directly: it hits exactly when the reuse distance (the number of
+// distinct blocks accessed since the last access to the block) is smaller than its number of blocks.
+// Reuse distances are counted with a Fenwick tree over the access times, with a mark at the last access of every
+// block, so each access costs O(log n)
+class MissClassifier {
+public:
+    // A block count of 0 disables the classification
+    explicit MissClassifier(int blockCount = 0, int setCount = 0) : blockCount(blockCount), setMisses(setCount, 0) {
+        if (isEnabled()) tree.assign(INITIAL_TIMES + 1, 0);
+    }
+
+    bool isEnabled() const {
+        return blockCount > 0;
+    }
+
+    void record(long long memoryBlockIndex, int setIndex, bool hit) {
+        if (time == (long long) tree.size() - 1) compact();
+
+        long long &lastTime = lastAccesses.insert(memoryBlockIndex);
+        long long distance = -1;
+        if (lastTime >= 0) {
+            distance = prefixSum(time - 1) - prefixSum(lastTime);
+            add(lastTime, -1);
+        }
+        lastTime = time;
+        add(time, 1);
+        time++;
+
+        // Reuse distances: 0, 1, 2-3, 4-7, ..., and cold accesses in the last bucket
+        size_t bucket = distance < 0 ? COLD : bucketOf(distance);
+        if (reuseDistances.size() <= bucket) reuseDistances.resize(bucket + 1, 0);
+        reuseDistances[bucket]++;
+
+        if (hit) return;
+        setMisses[setIndex]++;
+        if (distance < 0) {
+            compulsoryCount++;
+        } else if (distance >= blockCount) {
+            capacityCount++;
+        } else {
+            conflictCount++;
+        }
+    }
+
+    void print() const {
+        std::cout << "\nMisses: Compulsory: " << compulsoryCount << " / Capacity: " << capacityCount << " / Conflict: "
+                  << conflictCount << std::endl;
+
+        std::cout << "\nReuseDistance (distinct blocks between two accesses to a block)" << std::endl;
+        std::cout << std::setw(20) << "Distance" << std::setw(12) << "Accesses" << std::endl;
+        for (size_t bucket = 0; bucket < reuseDistances.size(); bucket++) {
+            if (bucket == COLD || reuseDistances[bucket] == 0) continue;
+            std::cout << std::setw(20) << bucketName(bucket) << std::setw(12) << reuseDistances[bucket] << std::endl;
+        }
+        std::cout << std::setw(20) << "Cold" << std::setw(12)
+                  << (reuseDistances.size() > COLD ? reuseDistances[COLD] : 0) << std::endl;
+
+        // Sets by their number of misses: 0, 1, 2-3, 4-7, ...
+        std::vector<long long> sets;
+        long long minimum = setMisses.empty() ? 0 : setMisses[0], maximum = 0, total = 0;
+        for (long long misses: setMisses) {
+            size_t bucket = misses == 0 ? 0 : bucketOf(misses - 1) + 1;
+            if (sets.size() <= bucket) sets.resize(bucket + 1, 0);
+            sets[bucket]++;
+            minimum = std::min(minimum, misses);
+            maximum = std::max(maximum, misses);
+            total += misses;
+        }
+        std::cout << "\nMissesPerSet: Min: " << minimum << " / Mean: "
+                  << (setMisses.empty() ? 0.0 : (double) total / setMisses.size()) << " / Max: " << maximum
+                  << std::endl;
+        std::cout << std::setw(20) << "Misses" << std::setw(12) << "Sets" << std::endl;
+        for (size_t bucket = 0; bucket < sets.size(); bucket++) {
+            if (sets[bucket] == 0) continue;
+            std::cout << std::setw(20) << (bucket == 0 ? "0" : bucketName(bucket - 1, 1)) << std::setw(12)
+                      << sets[bucket] << std::endl;
+        }
+    }
+
+private:
+    static const size_t COLD = 64;
+    static const long long INITIAL_TIMES = 1 << 20;
+
+    long long blockCount;
+    long long time = 0;
+    BlockTable lastAccesses;
+    std::vector<int> tree; // Fenwick tree, 1-based, over the access times
+    std::vector<long long> reuseDistances;
+    std::vector<long long> setMisses;
+    long long compulsoryCount = 0;
+    long long capacityCount = 0;
+    long long conflictCount = 0;
+
+    // 0 -> 0, 1 -> 1, 2-3 -> 2, 4-7 -> 3, ...
+    static size_t bucketOf(long long value) {
+        size_t bucket = 0;
+        while (value > 0) {
+            value >>= 1;
+            bucket++;
+        }
+        return bucket;
+    }
+
+    // The range of values in a bucket, shifted by offset
+    static std::string bucketName(size_t bucket, long long offset = 0) {
+        if (bucket <= 1) return std::to_string(bucket + offset);
+        long long first = 1ll << (bucket - 1);
+        return std::to_string(first + offset) + "-" + std::to_string(first * 2 - 1 + offset);
+    }
+
+    void add(long long index, int value) {
+        for (long long i = index + 1; i < (long long) tree.size(); i += i & -i) tree[i] += value;
+    }
+
+    // Sum of the marks at times 0 ... index
+    long long prefixSum(long long index) const {
+        long long sum = 0;
+        for (long long i = index + 1; i > 0; i -= i & -i) sum += tree[i];
+        return sum;
+    }
+
+    // The times ran out: renumber the last accesses 0, 1, 2, ... in their order, so the tree only needs to be
+    // a few times larger than the number of distinct blocks, however long the trace is
+    void compact() {
+        std::vector<std::pair<long long, long long *>> lastTimes;
+        lastTimes.reserve(lastAccesses.size());
+        lastAccesses.forEach([&](long long, long long &lastTime) {
+            lastTimes.emplace_back(lastTime, &lastTime);
+        });
+        std::sort(lastTimes.begin(), lastTimes.end());
+        for (size_t i = 0; i < lastTimes.size(); i++) *lastTimes[i].second = (long long) i;
+        time = (long long) lastTimes.size();
+
+        tree.assign((size_t) std::max((long long) INITIAL_TIMES, time * 2) + 1, 0);
+        for (long long i = 0; i < time; i++) add(i, 1);
+    }
+};
+
+#endif //CACHE_SIMULATOR_MISS_CLASSIFIER_H
@@ -0,0 +1,222 @@
+#ifndef CACHE_SIMULATOR_MULTICORE_H
+#define CACHE_SIMULATOR_MULTICORE_H
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <cstdint>
+#include "block_table.h"
+#include "cache.h"
+#include "trace.h"
+
+// MESI state of a block in the cache of a core. Blocks missing from a state table are MESI_INVALID
+enum MesiState {
+    MESI_INVALIDATED = -2, // Invalid since another core wrote the block, the next miss is a coherence miss
+    MESI_INVALID = -1,
+    MESI_SHARED = 0,
+    MESI_EXCLUSIVE = 1,
+    MESI_MODIFIED = 2,
+};
+
+// Counters of one core
+struct CoreStatistics {
+    long long accessCount = 0;
+    long long hitCount = 0;
+    long long coherenceMissCount = 0; // Misses to blocks another core invalidated
+    long long invalidationCount = 0;  // Blocks invalidated by the writes of other cores
+    long long writeBackCount = 0;     // Modified blocks replaced
+
+    void add(const CoreStatistics &other) {
+        accessCount += other.accessCount;
+        hitCount += other.hitCount;
+        coherenceMissCount += other.coherenceMissCount;
+        invalidationCount += other.invalidationCount;
+        writeBackCount += other.writeBackCount;
+    }
+};
+
+// Counters of the snooping bus
+struct BusStatistics {
+    long long readCount = 0;          // BusRd: read miss
+    long long readExclusiveCount = 0; // BusRdX: write miss
+    long long upgradeCount = 0;       // BusUpgr: write hit to a shared block
+    long long flushCount = 0;         // A modified block written back because another core asked for it
+
+    void add(const BusStatistics &other) {
+        readCount += other.readCount;
+        readExclusiveCount += other.readExclusiveCount;
+        upgradeCount += other.upgradeCount;
+        flushCount += other.flushCount;
+    }
+};
+
+// Private caches of several cores, kept coherent with MESI over a snooping bus
+// The traces of the cores are interleaved round-robin: round r is access r of every core, in core order.
+// The bus orders the transactions to a block, and a block only ever meets the blocks of its own set in any core,
+// so the sets are split into shards simulated by separate threads. Each shard sees its accesses in the global
+// order, so the results are identical to a serial run, and the threads never synchronize until the end
+template<typename ReplacementPolicy, bool PowerOfTwo>
+class MulticoreSimulation {
+public:
+    typedef SetAssociativeCache<ReplacementPolicy, PowerOfTwo> CacheType;
+
+    MulticoreSimulation(const CacheGeometry &geometry, int coreCount, int threadCount)
+            : mapping(geometry), setCount(geometry.getSetCount()),
+              shardCount(std::max(1, std::min(threadCount, setCount))), traces(coreCount) {
+        for (int core = 0; core < coreCount; core++) caches.emplace_back(geometry);
+        for (int shard = 0; shard < shardCount; shard++) shards.emplace_back(coreCount);
+    }
+
+    // Read the trace of every core, converted to memory block indexes. Return false if a trace cannot be opened
+    bool load(const std::vector<std::string> &traceFilePaths) {
+        std::vector<unsigned char> opened(traceFilePaths.size(), 0);
+        forEachThread((int) traceFilePaths.size(), [&](int thread, int threadCount) {
+            for (size_t core = thread; core < traceFilePaths.size(); core += threadCount) {
+                TraceFile traceFile;
+                if (!traceFile.open(traceFilePaths[core])) continue;
+                opened[core] = 1;
+                traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+                    traces[core].memoryBlockIndexes.push_back(mapping.getMemoryBlockIndex(memoryAddress));
+                    traces[core].writes.push_back(write);
+                });
+            }
+        });
+        return std::find(opened.begin(), opened.end(), 0) == opened.end();
+    }
+
+    void run() {
+        size_t roundCount = 0;
+        for (const CoreTrace &trace: traces) roundCount = std::max(roundCount, trace.writes.size());
+        forEachThread(shardCount, [&](int shard, int) {
+            for (size_t round = 0; round < roundCount; round++) {
+                for (int core = 0; core < (int) traces.size(); core++) {
+                    const CoreTrace &trace = traces[core];
+                    if (round >= trace.writes.size()) continue;
+                    long long memoryBlockIndex = trace.memoryBlockIndexes[round];
+                    if ((long long) mapping.getSetIndex(memoryBlockIndex) * shardCount / setCount != shard) continue;
+                    access(shards[shard], core, memoryBlockIndex, trace.writes[round] != 0, (long long) round);
+                }
+            }
+        });
+    }
+
+    void printStatistics() const {
+        std::vector<CoreStatistics> cores(traces.size());
+        BusStatistics bus;
+        for (const Shard &shard: shards) {
+            for (size_t core = 0; core < traces.size(); core++) cores[core].add(shard.cores[core]);
+            bus.add(shard.bus);
+        }
+
+        CoreStatistics total;
+        std::cout << "\nCores: " << traces.size() << std::endl;
+        std::cout << std::setw(6) << "Core" << std::setw(12) << "Accesses" << std::setw(12) << "Hits"
+                  << std::setw(12) << "Misses" << std::setw(12) << "MissRate" << std::setw(12) << "Coherence"
+                  << std::setw(12) << "Invalidated" << std::setw(12) << "WriteBacks" << std::endl;
+        for (size_t core = 0; core <= cores.size(); core++) {
+            const CoreStatistics &statistics = core < cores.size() ? cores[core] : total;
+            long long missCount = statistics.accessCount - statistics.hitCount;
+            std::cout << std::setw(6) << (core < cores.size() ? std::to_string(core) : "Total") << std::setw(12)
+                      << statistics.accessCount << std::setw(12) << statistics.hitCount << std::setw(12) << missCount
+                      << std::setw(12) << (statistics.accessCount ? (double) missCount / statistics.accessCount : 0.0)
+                      << std::setw(12) << statistics.coherenceMissCount << std::setw(12)
+                      << statistics.invalidationCount << std::setw(12) << statistics.writeBackCount << std::endl;
+            if (core < cores.size()) total.add(statistics);
+        }
+
+        std::cout << "\nBus: Transactions: " << bus.readCount + bus.readExclusiveCount + bus.upgradeCount
+                  << " / BusRd: " << bus.readCount << " / BusRdX: " << bus.readExclusiveCount << " / BusUpgr: "
+                  << bus.upgradeCount << " / Flushes: " << bus.flushCount << std::endl;
+    }
+
+private:
+    struct CoreTrace {
+        std::vector<long long> memoryBlockIndexes;
+        std::vector<unsigned char> writes;
+    };
+
+    // Everything a thread writes: the MESI states of the blocks in its sets, and its counters
+    struct Shard {
+        explicit Shard(int coreCount) : states(coreCount), cores(coreCount) {}
+
+        std::vector<BlockTable> states; // One table per core
+        std::vector<CoreStatistics> cores;
+        BusStatistics bus;
+    };
+
+    AddressMapping<PowerOfTwo> mapping;
+    int setCount;
+    int shardCount;
+    std::vector<CoreTrace> traces;
+    std::vector<CacheType> caches;
+    std::vector<Shard> shards;
+
+    // Call run(thread, threadCount) on threadCount threads and wait for them
+    template<typename Run>
+    static void forEachThread(int threadCount, Run run) {
+        std::vector<std::thread> threads;
+        for (int thread = 1; thread < threadCount; thread++) threads.emplace_back(run, thread, threadCount);
+        run(0, threadCount);
+        for (std::thread &thread: threads) thread.join();
+    }
+
+    void access(Shard &shard, int core, long long memoryBlockIndex, bool write, long long time) {
+        CoreStatistics &statistics = shard.cores[core];
+        long long &state = shard.states[core].insert(memoryBlockIndex);
+        statistics.accessCount++;
+
+        if (state >= MESI_SHARED) {
+            caches[core].lookup(memoryBlockIndex, time);
+            statistics.hitCount++;
+            if (write && state == MESI_SHARED) {
+                shard.bus.upgradeCount++;
+                snoop(shard, core, memoryBlockIndex, true);
+            }
+            // Writing an exclusive block needs no bus transaction
+            if (write) state = MESI_MODIFIED;
+            return;
+        }
+
+        if (state == MESI_INVALIDATED) statistics.coherenceMissCount++;
+        if (write) {
+            shard.bus.readExclusiveCount++;
+        } else {
+            shard.bus.readCount++;
+        }
+        bool shared = snoop(shard, core, memoryBlockIndex, write);
+        state = write ? MESI_MODIFIED : shared ? MESI_SHARED : MESI_EXCLUSIVE;
+
+        long long replacedBlockIndex = caches[core].insert(memoryBlockIndex, time);
+        if (replacedBlockIndex >= 0) {
+            long long *replacedState = shard.states[core].find(replacedBlockIndex);
+            if (*replacedState == MESI_MODIFIED) statistics.writeBackCount++;
+            *replacedState = MESI_INVALID;
+        }
+    }
+
+    // Broadcast a transaction to the other cores: they give up the block if exclusive is set, otherwise they
+    // keep a shared copy. A modified copy is flushed to the memory first. Return if any other core had the block
+    bool snoop(Shard &shard, int requester, long long memoryBlockIndex, bool exclusive) {
+        bool shared = false;
+        for (int core = 0; core < (int) caches.size(); core++) {
+            if (core == requester) continue;
+            long long *state = shard.states[core].find(memoryBlockIndex);
+            if (state == nullptr || *state < MESI_SHARED) continue;
+            shared = true;
+            if (*state == MESI_MODIFIED) shard.bus.flushCount++;
+            if (exclusive) {
+                caches[core].invalidate(memoryBlockIndex);
+                *state = MESI_INVALIDATED;
+                shard.cores[core].invalidationCount++;
+            } else {
+                *state = MESI_SHARED;
+            }
+        }
+        return shared;
+    }
+};
+
+#endif //CACHE_SIMULATOR_MULTICORE_H
@@ -0,0 +1,196 @@
+#ifndef CACHE_SIMULATOR_PREFETCHER_H
+#define CACHE_SIMULATOR_PREFETCHER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include "cache.h"
+
+// A prefetch is late if its block is accessed less than this many accesses after it was issued,
+// because the fill would still be on its way from the next level
+#define PREFETCH_LATENCY 8
+
+// Prefetchers are template arguments of the simulation, like the replacement policies. Every prefetcher provides:
+//   static const bool ENABLED
+//   void onAccess(long long memoryBlockIndex, int flags, Prefetch prefetch)
+// which is called after every demand access with its AccessFlags. It calls prefetch(memoryBlockIndex)
+// for every block it wants in the cache, and the block is filled into the same set-associative cache
+
+// No prefetching, the default. The simulation skips all the prefetch bookkeeping
+class NoPrefetcher {
+public:
+    static const bool ENABLED = false;
+
+    template<typename Prefetch>
+    void onAccess(long long, int, Prefetch) {}
+};
+
+// Next-line: fetch the following blocks on a miss, and again on the first access to a prefetched block
+// (tagged prefetching), so a sequential run stays ahead of the demand accesses
+class NextLinePrefetcher {
+public:
+    static const bool ENABLED = true;
+
+    explicit NextLinePrefetcher(int degree) : degree(degree) {}
+
+    template<typename Prefetch>
+    void onAccess(long long memoryBlockIndex, int flags, Prefetch prefetch) {
+        if ((flags & ACCESS_HIT) && !(flags & ACCESS_PREFETCH_HIT)) return;
+        for (int i = 1; i <= degree; i++) prefetch(memoryBlockIndex + i);
+    }
+
+private:
+    int degree;
+};
+
+// Stride: the trace has no program counters, so the address streams are told apart by their memory region
+// Every region remembers its last block and stride, and prefetches ahead once the same stride is seen twice
+class StridePrefetcher {
+public:
+    static const bool ENABLED = true;
+    static const int TABLE_SIZE = 256;   // Regions tracked at the same time (direct-mapped)
+    static const int REGION_BYTES = 4096;
+    static const int CONFIDENT = 2;      // Confidence needed to prefetch, counted up to 3
+
+    StridePrefetcher(int degree, int blockSize) : degree(degree), entries(TABLE_SIZE) {
+        blocksPerRegion = std::max(1, REGION_BYTES / (blockSize * 4));
+    }
+
+    template<typename Prefetch>
+    void onAccess(long long memoryBlockIndex, int, Prefetch prefetch) {
+        long long region = memoryBlockIndex / blocksPerRegion;
+        Entry &entry = entries[region % TABLE_SIZE];
+        if (!entry.valid || entry.region != region) {
+            entry = Entry();
+            entry.valid = true;
+            entry.region = region;
+            entry.lastBlock = memoryBlockIndex;
+            return;
+        }
+
+        // Accesses within the same block say nothing about the stride
+        long long stride = memoryBlockIndex - entry.lastBlock;
+        if (stride == 0) return;
+        entry.lastBlock = memoryBlockIndex;
+        if (stride == entry.stride) {
+            if (entry.confidence < 3) entry.confidence++;
+        } else if (entry.confidence > 0) {
+            entry.confidence--;
+        } else {
+            entry.stride = stride;
+        }
+
+        if (entry.confidence < CONFIDENT) return;
+        for (int i = 1; i <= degree; i++) prefetch(memoryBlockIndex + entry.stride * i);
+    }
+
+private:
+    struct Entry {
+        bool valid = false;
+        long long region = 0;
+        long long lastBlock = 0;
+        long long stride = 0;
+        int confidence = 0;
+    };
+
+    int degree;
+    int blocksPerRegion;
+    std::vector<Entry> entries;
+};
+
+// Stream buffers: a miss outside every stream starts a new one (replacing the least recently used stream),
+// which runs ahead of the accesses by the given depth. The blocks are filled into the cache itself
+class StreamPrefetcher {
+public:
+    static const bool ENABLED = true;
+    static const int STREAM_COUNT = 4;
+
+    explicit StreamPrefetcher(int depth) : depth(depth), streams(STREAM_COUNT) {}
+
+    template<typename Prefetch>
+    void onAccess(long long memoryBlockIndex, int flags, Prefetch prefetch) {
+        time++;
+        for (Stream &stream: streams) {
+            // An access inside the window moves the stream forward
+            if (stream.valid && memoryBlockIndex >= stream.next && memoryBlockIndex <= stream.last) {
+                stream.next = memoryBlockIndex + 1;
+                stream.lastUse = time;
+                for (; stream.last < memoryBlockIndex + depth; stream.last++) prefetch(stream.last + 1);
+                return;
+            }
+        }
+        if (flags & ACCESS_HIT) return;
+
+        Stream *victim = &streams[0];
+        for (Stream &stream: streams) {
+            if (!stream.valid || stream.lastUse < victim->lastUse) victim = &stream;
+            if (!stream.valid) break;
+        }
+        victim->valid = true;
+        victim->next = memoryBlockIndex + 1;
+        victim->last = memoryBlockIndex + depth;
+        victim->lastUse = time;
+        for (int i = 1; i <= depth; i++) prefetch(memoryBlockIndex + i);
+    }
+
+private:
+    struct Stream {
+        bool valid = false;
+        long long next = 0; // First block expected next
+        long long last = 0; // Last block prefetched
+        long long lastUse = 0;
+    };
+
+    int depth;
+    long long time = 0;
+    std::vector<Stream> streams;
+};
+
+// Parse a prefetcher: "none", or "next-line", "stride" or "stream" with an optional ":N" for the number of blocks
+// fetched ahead. Return false if the format is incorrect
+inline bool parsePrefetcher(const std::string &text, std::string &name, int &degree) {
+    size_t separator = text.find(':');
+    name = text.substr(0, separator);
+    degree = name == "stream" ? 4 : 1;
+    if (separator != std::string::npos) {
+        char *end;
+        degree = std::strtol(text.c_str() + separator + 1, &end, 10);
+        if (*end != '\0' || degree <= 0) return false;
+    }
+    return name == "none" || name == "next-line" || name == "stride" || name == "stream";
+}
+
+// Counts what happened to the prefetched blocks, apart from the demand hits and misses
+class PrefetchStatistics {
+public:
+    // Call after every demand access with its flags, and whether a cache without the prefetcher would have hit
+    void onAccess(int flags, bool hitWithoutPrefetching) {
+        if (flags & ACCESS_PREFETCH_HIT) usefulCount++;
+        if (flags & ACCESS_PREFETCH_LATE) lateCount++;
+        if (flags & ACCESS_PREFETCH_DROP) uselessCount++;
+        if (!(flags & ACCESS_HIT) && hitWithoutPrefetching) pollutionCount++;
+    }
+
+    // Call for every prefetch with the flags returned by the cache (0 if the block was already there)
+    void onPrefetch(int flags) {
+        if (flags & ACCESS_FILL) issuedCount++;
+        if (flags & ACCESS_PREFETCH_DROP) uselessCount++;
+    }
+
+    void print() const {
+        std::cout << "\nPrefetches: " << issuedCount << " / Useful: " << usefulCount << " / Late: " << lateCount
+                  << " / Useless: " << uselessCount << std::endl;
+        std::cout << "PollutionMisses: " << pollutionCount << std::endl;
+    }
+
+private:
+    long long issuedCount = 0;
+    long long usefulCount = 0;    // Prefetched blocks which were accessed (including the late ones)
+    long long lateCount = 0;      // Prefetched blocks which were accessed before the prefetch could arrive
+    long long uselessCount = 0;   // Prefetched blocks which were replaced before any access
+    long long pollutionCount = 0; // Demand misses which a cache without the prefetcher would not have had
+};
+
+#endif //CACHE_SIMULATOR_PREFETCHER_H
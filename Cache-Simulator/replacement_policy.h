@@ -0,0 +1,286 @@
+#ifndef CACHE_SIMULATOR_REPLACEMENT_POLICY_H
+#define CACHE_SIMULATOR_REPLACEMENT_POLICY_H
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <cstdint>
+#include <unordered_map>
+#include "way_search.h"
+
+// Replacement policies are template arguments of SetAssociativeCache, so their calls are inlined into the access loop
+// Every policy provides:
+//   Policy(int blockCount, int setDegree, ...)
+//   void onHit(int setIndex, int way, long long time)   - a valid block in the set is accessed
+//   void onFill(int setIndex, int way, long long time)  - a new block is inserted into the set
+//   int findVictim(int setIndex, long long time)        - choose the block to be replaced in a full set
+// where time is the number of the access in the trace, which never wraps around. A policy must only touch the state
+// of the given set, so that different sets can be simulated by different threads
+
+// Hash the number of an access into a pseudo-random number (splitmix64)
+// Random decisions only depend on the access, not on the order in which threads run
+inline uint64_t hashAccess(uint64_t time, uint64_t salt) {
+    uint64_t z = time * 0x9E3779B97F4A7C15ull + salt;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// The times of the blocks of every set, stored as ints so the oldest way can be found with SIMD (see findOldest)
+// Every set keeps its times relative to its own base. When a time does not fit any more, the times of the set are
+// replaced by their ranks, which keeps their order (and their ties), so any number of accesses is exact
+class SetTimes {
+public:
+    SetTimes(int blockCount, int setDegree)
+            : setDegree(setDegree), times(blockCount, 0), bases(blockCount / setDegree, 0) {}
+
+    void set(int setIndex, int way, long long time) {
+        long long relativeTime = time - bases[setIndex];
+        if (relativeTime > std::numeric_limits<int>::max()) relativeTime = rebase(setIndex, time);
+        times[setIndex * setDegree + way] = (int) relativeTime;
+    }
+
+    const int *get(int setIndex) const {
+        return &times[setIndex * setDegree];
+    }
+
+private:
+    int setDegree;
+    std::vector<int> times;
+    std::vector<long long> bases;
+
+    // Rank the times of a set 0, 1, ... and move its base so that time comes right after them
+    // Return time relative to the new base
+    long long rebase(int setIndex, long long time) {
+        int *set = &times[setIndex * setDegree];
+        std::vector<int> sorted(set, set + setDegree);
+        std::sort(sorted.begin(), sorted.end());
+        sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+        for (int way = 0; way < setDegree; way++) {
+            set[way] = (int) (std::lower_bound(sorted.begin(), sorted.end(), set[way]) - sorted.begin());
+        }
+        bases[setIndex] = time - setDegree;
+        return setDegree;
+    }
+};
+
+// Least recently used: replace the block with the oldest access time
+class LruPolicy {
+public:
+    LruPolicy(int blockCount, int setDegree) : setDegree(setDegree), times(blockCount, setDegree) {}
+
+    void onHit(int setIndex, int way, long long time) {
+        times.set(setIndex, way, time);
+    }
+
+    void onFill(int setIndex, int way, long long time) {
+        times.set(setIndex, way, time);
+    }
+
+    int findVictim(int setIndex, long long) const {
+        return findOldest(times.get(setIndex), setDegree);
+    }
+
+private:
+    int setDegree;
+    SetTimes times;
+};
+
+// First in, first out: replace the block with the oldest insertion time, hits do not matter
+class FifoPolicy {
+public:
+    FifoPolicy(int blockCount, int setDegree) : setDegree(setDegree), insertionTimes(blockCount, setDegree) {}
+
+    void onHit(int, int, long long) {}
+
+    void onFill(int setIndex, int way, long long time) {
+        insertionTimes.set(setIndex, way, time);
+    }
+
+    int findVictim(int setIndex, long long) const {
+        return findOldest(insertionTimes.get(setIndex), setDegree);
+    }
+
+private:
+    int setDegree;
+    SetTimes insertionTimes;
+};
+
+// Random replacement
+class RandomPolicy {
+public:
+    RandomPolicy(int, int setDegree) : setDegree(setDegree) {}
+
+    void onHit(int, int, long long) {}
+
+    void onFill(int, int, long long) {}
+
+    int findVictim(int, long long time) const {
+        return (int) (hashAccess((uint64_t) time, 0x5EED) % (uint64_t) setDegree);
+    }
+
+private:
+    int setDegree;
+};
+
+// Tree pseudo-LRU: a binary tree over the ways of each set, every node points to the half which was used less recently
+// Set degrees which are not powers of two use the tree of the next power of two, without the missing leaves
+class TreePlruPolicy {
+public:
+    TreePlruPolicy(int blockCount, int setDegree) : setDegree(setDegree) {
+        while (leafCount < setDegree) leafCount *= 2;
+        bits.assign((size_t) (blockCount / setDegree) * leafCount, 0);
+    }
+
+    void onHit(int setIndex, int way, long long) {
+        touch(setIndex, way);
+    }
+
+    void onFill(int setIndex, int way, long long) {
+        touch(setIndex, way);
+    }
+
+    int findVictim(int setIndex, long long) const {
+        // Nodes are numbered as a heap (root = 1), leaves are leafCount ... 2 * leafCount - 1
+        const unsigned char *tree = &bits[(size_t) setIndex * leafCount];
+        int node = 1, firstLeaf = 0, width = leafCount;
+        while (node < leafCount) {
+            width /= 2;
+            // Go right if the node points there and that half has any real ways
+            if (tree[node] && firstLeaf + width < setDegree) {
+                node = node * 2 + 1;
+                firstLeaf += width;
+            } else {
+                node = node * 2;
+            }
+        }
+        return firstLeaf;
+    }
+
+private:
+    int setDegree;
+    int leafCount = 1;
+    std::vector<unsigned char> bits;
+
+    // Make every node on the path to the way point away from it
+    void touch(int setIndex, int way) {
+        unsigned char *tree = &bits[(size_t) setIndex * leafCount];
+        for (int node = way + leafCount; node > 1; node /= 2) {
+            tree[node / 2] = (node % 2 == 0) ? 1 : 0;
+        }
+    }
+};
+
+// Re-reference interval prediction with 2-bit predictions (RRPV), replace a block predicted to be re-used last
+// Static RRIP inserts new blocks with a long interval, bimodal RRIP with a distant one
+// (and a long one 1/32 of the time)
+template<bool Bimodal>
+class RripPolicy {
+public:
+    static const unsigned char MAX_RRPV = 3;
+
+    RripPolicy(int blockCount, int setDegree) : setDegree(setDegree), rrpv(blockCount, (unsigned char) MAX_RRPV) {}
+
+    void onHit(int setIndex, int way, long long) {
+        rrpv[setIndex * setDegree + way] = 0;
+    }
+
+    void onFill(int setIndex, int way, long long time) {
+        bool distant = Bimodal && hashAccess((uint64_t) time, 0xB1) % 32 != 0;
+        rrpv[setIndex * setDegree + way] = distant ? MAX_RRPV : MAX_RRPV - 1;
+    }
+
+    int findVictim(int setIndex, long long) {
+        unsigned char *set = &rrpv[setIndex * setDegree];
+        // Age all the blocks until one reaches the distant interval
+        while (true) {
+            for (int way = 0; way < setDegree; way++) {
+                if (set[way] == MAX_RRPV) return way;
+            }
+            for (int way = 0; way < setDegree; way++) set[way]++;
+        }
+    }
+
+private:
+    int setDegree;
+    std::vector<unsigned char> rrpv;
+};
+
+typedef RripPolicy<false> SrripPolicy;
+typedef RripPolicy<true> BrripPolicy;
+
+// Belady's optimal policy: replace the block which is accessed again furthest in the future
+// It needs the number of the next access to the same memory block for every access of the trace
+class OptimalPolicy {
+public:
+    static const long long NEVER = std::numeric_limits<long long>::max();
+
+    OptimalPolicy(int blockCount, int setDegree, const std::vector<long long> *nextUses)
+            : setDegree(setDegree), nextUses(nextUses), nextUseTimes(blockCount, (long long) NEVER) {}
+
+    // Look ahead over the memory block indexes of the whole trace, and find the next access of each one
+    static std::vector<long long> findNextUses(const std::vector<long long> &memoryBlockIndexes) {
+        std::vector<long long> nextUses(memoryBlockIndexes.size(), (long long) NEVER);
+        std::unordered_map<long long, long long> nextAccess;
+        nextAccess.reserve(memoryBlockIndexes.size() / 4 + 16);
+        for (long long i = (long long) memoryBlockIndexes.size() - 1; i >= 0; i--) {
+            auto found = nextAccess.find(memoryBlockIndexes[i]);
+            if (found != nextAccess.end()) {
+                nextUses[i] = found->second;
+                found->second = i;
+            } else {
+                nextAccess.emplace(memoryBlockIndexes[i], i);
+            }
+        }
+        return nextUses;
+    }
+
+    void onHit(int setIndex, int way, long long time) {
+        nextUseTimes[setIndex * setDegree + way] = (*nextUses)[time];
+    }
+
+    void onFill(int setIndex, int way, long long time) {
+        nextUseTimes[setIndex * setDegree + way] = (*nextUses)[time];
+    }
+
+    int findVictim(int setIndex, long long) const {
+        const long long *set = &nextUseTimes[setIndex * setDegree];
+        int victim = 0;
+        for (int way = 1; way < setDegree; way++) {
+            if (set[way] > set[victim]) victim = way;
+        }
+        return victim;
+    }
+
+private:
+    int setDegree;
+    const std::vector<long long> *nextUses;
+    std::vector<long long> nextUseTimes;
+};
+
+template<typename ReplacementPolicy>
+struct PolicyType {
+    typedef ReplacementPolicy Type;
+};
+
+// Call run(PolicyType<Policy>()) with the replacement policy of the given name
+// The optimal policy needs the whole trace in advance, so it is handled by the caller
+template<typename Run>
+void dispatchReplacementPolicy(const std::string &name, Run run) {
+    if (name == "plru") {
+        run(PolicyType<TreePlruPolicy>());
+    } else if (name == "fifo") {
+        run(PolicyType<FifoPolicy>());
+    } else if (name == "random") {
+        run(PolicyType<RandomPolicy>());
+    } else if (name == "srrip") {
+        run(PolicyType<SrripPolicy>());
+    } else if (name == "brrip") {
+        run(PolicyType<BrripPolicy>());
+    } else {
+        run(PolicyType<LruPolicy>());
+    }
+}
+
+#endif //CACHE_SIMULATOR_REPLACEMENT_POLICY_H
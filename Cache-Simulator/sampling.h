@@ -0,0 +1,74 @@
+#ifndef CACHE_SIMULATOR_SAMPLING_H
+#define CACHE_SIMULATOR_SAMPLING_H
+
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+
+// 95% confidence, two-sided
+#define SAMPLING_Z 1.96
+
+// Estimate the miss rate of a whole trace from samples (sets or windows of the trace)
+// Each sample is a cluster of accesses, so the miss rate is a ratio estimate over the clusters
+class MissRateEstimate {
+public:
+    void add(long long accesses, long long misses) {
+        sampleAccesses.push_back(accesses);
+        sampleMisses.push_back(misses);
+        accessCount += accesses;
+        missCount += misses;
+    }
+
+    long long getAccessCount() const {
+        return accessCount;
+    }
+
+    long long getMissCount() const {
+        return missCount;
+    }
+
+    int getSampleCount() const {
+        return (int) sampleAccesses.size();
+    }
+
+    double getMissRate() const {
+        return accessCount ? (double) missCount / accessCount : 0.0;
+    }
+
+    // Half width of the confidence interval around the miss rate. The samples were taken from populationSize
+    // samples in total (0 if unknown), which shrinks the interval when most of the population was simulated
+    double getHalfWidth(long long populationSize) const {
+        int n = getSampleCount();
+        if (n < 2 || accessCount == 0) return 0.0;
+        double rate = getMissRate(), squares = 0.0;
+        for (int i = 0; i < n; i++) {
+            double residual = sampleMisses[i] - rate * sampleAccesses[i];
+            squares += residual * residual;
+        }
+        double meanAccesses = (double) accessCount / n;
+        double correction = populationSize > 0 ? 1.0 - (double) n / populationSize : 1.0;
+        if (correction < 0) correction = 0;
+        return SAMPLING_Z * std::sqrt(correction * squares / (n - 1) / n) / meanAccesses;
+    }
+
+private:
+    std::vector<long long> sampleAccesses;
+    std::vector<long long> sampleMisses;
+    long long accessCount = 0;
+    long long missCount = 0;
+};
+
+// Parse "period,window[,warmup]" of time sampling: every period accesses, warmup accesses warm the cache up,
+// then window accesses are measured. Return false if the format is incorrect
+inline bool parseTimeSampling(const std::string &text, long long &period, long long &window, long long &warmup) {
+    char *end;
+    period = std::strtoll(text.c_str(), &end, 10);
+    if (*end != ',') return false;
+    window = std::strtoll(end + 1, &end, 10);
+    warmup = 0;
+    if (*end == ',') warmup = std::strtoll(end + 1, &end, 10);
+    return *end == '\0' && window > 0 && warmup >= 0 && window + warmup <= period;
+}
+
+#endif //CACHE_SIMULATOR_SAMPLING_H
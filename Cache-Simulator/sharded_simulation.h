@@ -0,0 +1,160 @@
+#ifndef CACHE_SIMULATOR_SHARDED_SIMULATION_H
+#define CACHE_SIMULATOR_SHARDED_SIMULATION_H
+
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include "cache.h"
+#include "trace.h"
+
+// Simulate a cache with several threads. Sets never interact, so they are split into contiguous ranges (shards),
+// one per thread. The trace is read in batches and every address is routed to the shard owning its set.
+// Each access keeps its number in the trace as LRU time, so the results are identical to a serial run
+template<typename CacheType>
+class ShardedSimulation {
+public:
+    static const int BATCH_SIZE = 1 << 16;
+
+    ShardedSimulation(CacheType &cache, int threadCount, WritePolicy writePolicy = WritePolicy())
+            : cache(cache), writePolicy(writePolicy),
+              shardCount(std::max(1, std::min(threadCount, cache.getSetCount()))) {
+        for (Batch &batch: batches) batch.shardAccesses.resize(shardCount);
+        for (int shard = 0; shard < shardCount; shard++) workers.emplace_back(&ShardedSimulation::work, this, shard);
+    }
+
+    ShardedSimulation(const ShardedSimulation &) = delete;
+    ShardedSimulation &operator=(const ShardedSimulation &) = delete;
+
+    ~ShardedSimulation() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        batchReady.notify_all();
+        for (std::thread &worker: workers) worker.join();
+    }
+
+    int getShardCount() const {
+        return shardCount;
+    }
+
+    // Simulate the whole trace. After each batch, onBatch(addresses, writes, results, firstNumber) is called in trace
+    // order, where results[i] holds the AccessFlags of addresses[i] (a write if writes[i] is set)
+    // and firstNumber is the number of the first access (starting from 0)
+    template<typename Visitor>
+    void run(const TraceFile &traceFile, Visitor onBatch) {
+        int current = 0;
+        bool inFlight = false;
+        long long nextNumber = 0;
+
+        // Route the filled batch, hand it to the workers, then report the previous one while they are busy
+        auto dispatch = [&]() {
+            Batch &batch = batches[current];
+            batch.firstNumber = nextNumber;
+            nextNumber += (int) batch.addresses.size();
+            batch.results.assign(batch.addresses.size(), 0);
+            for (auto &accesses: batch.shardAccesses) accesses.clear();
+            for (size_t i = 0; i < batch.addresses.size(); i++) {
+                int setIndex = cache.getSetIndex(cache.getMemoryBlockIndex(batch.addresses[i]));
+                batch.shardAccesses[(long long) setIndex * shardCount / cache.getSetCount()].push_back((uint32_t) i);
+            }
+
+            if (inFlight) waitForWorkers();
+            startWorkers(current);
+            if (inFlight) {
+                Batch &previous = batches[1 - current];
+                onBatch(previous.addresses, previous.writes, previous.results, previous.firstNumber);
+                previous.addresses.clear();
+                previous.writes.clear();
+            }
+            inFlight = true;
+            current = 1 - current;
+        };
+
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            batches[current].addresses.push_back(memoryAddress);
+            batches[current].writes.push_back(write);
+            if (batches[current].addresses.size() == BATCH_SIZE) dispatch();
+        });
+        if (!batches[current].addresses.empty()) dispatch();
+        if (inFlight) {
+            waitForWorkers();
+            Batch &last = batches[1 - current];
+            onBatch(last.addresses, last.writes, last.results, last.firstNumber);
+            last.addresses.clear();
+            last.writes.clear();
+        }
+    }
+
+private:
+    struct Batch {
+        std::vector<uint64_t> addresses;
+        std::vector<unsigned char> writes;
+        std::vector<unsigned char> results;
+        // Indexes (into addresses) of the accesses owned by each shard, in trace order
+        std::vector<std::vector<uint32_t>> shardAccesses;
+        long long firstNumber = 0;
+    } batches[2];
+
+    CacheType &cache;
+    WritePolicy writePolicy;
+    int shardCount;
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable batchReady;
+    std::condition_variable batchDone;
+    long long generation = 0; // Increased every time a batch is handed to the workers
+    int activeBatch = 0;
+    int remainingWorkers = 0;
+    bool stopping = false;
+
+    void startWorkers(int batchIndex) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeBatch = batchIndex;
+            remainingWorkers = shardCount;
+            generation++;
+        }
+        batchReady.notify_all();
+    }
+
+    void waitForWorkers() {
+        std::unique_lock<std::mutex> lock(mutex);
+        batchDone.wait(lock, [this] { return remainingWorkers == 0; });
+    }
+
+    void work(int shard) {
+        long long seenGeneration = 0;
+        while (true) {
+            int batchIndex;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                batchReady.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+                batchIndex = activeBatch;
+            }
+
+            // Only this shard touches these sets, and each access writes its own result
+            Batch &batch = batches[batchIndex];
+            for (uint32_t i: batch.shardAccesses[shard]) {
+                long long memoryBlockIndex = cache.getMemoryBlockIndex(batch.addresses[i]);
+                batch.results[i] = (unsigned char) cache.access(cache.getSetIndex(memoryBlockIndex),
+                                                                cache.getTag(memoryBlockIndex),
+                                                                batch.firstNumber + (long long) i, batch.writes[i] != 0,
+                                                                writePolicy);
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (--remainingWorkers == 0) batchDone.notify_one();
+            }
+        }
+    }
+};
+
+#endif //CACHE_SIMULATOR_SHARDED_SIMULATION_H
@@ -0,0 +1,348 @@
+#ifndef CACHE_SIMULATOR_SIMULATION_H
+#define CACHE_SIMULATOR_SIMULATION_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include "access_log.h"
+#include "cache.h"
+#include "cache_model.h"
+#include "hierarchy.h"
+#include "miss_classifier.h"
+#include "multicore.h"
+#include "prefetcher.h"
+#include "sampling.h"
+#include "sharded_simulation.h"
+#include "sweep.h"
+#include "trace.h"
+#include "window_report.h"
+
+// The simulations run by the command line tool. Each one runs a whole trace and prints its results
+
+// Accesses given to the Cache library at once by simulateWithCache()
+#define LIBRARY_BATCH_SIZE 4096
+
+// Run every cache up to the given size and set degree in a single pass over the trace
+inline int runSweep(const std::string &traceFilePath, int maxCacheSize, int blockSize, int maxSetDegree) {
+    TraceFile traceFile;
+    if (!traceFile.open(traceFilePath)) {
+        std::cerr << "Cannot open the trace file!" << std::endl;
+        exit(1);
+    }
+
+    CacheSweep sweep(maxCacheSize, blockSize, maxSetDegree);
+    traceFile.forEachAddress([&](uint64_t memoryAddress) {
+        sweep.access((long long) memoryAddress);
+    });
+    sweep.printMissRateTable();
+    return 0;
+}
+
+// Simulate the trace with the given replacement policy and prefetcher, then print the results
+// With PowerOfTwo, the geometry must be a power of two (see dispatchAddressMapping())
+// With an enabled window report, the miss rate of every window is printed instead of the final results
+// With an enabled miss classifier, the kinds of misses and the histograms are printed after the final results
+template<typename ReplacementPolicy, bool PowerOfTwo, typename Prefetcher, typename... PolicyArguments>
+void simulate(const TraceFile &traceFile, const CacheGeometry &geometry, int threadCount, Prefetcher &prefetcher,
+              const WritePolicy &writePolicy, AccessLog &accessLog, WindowReport &windowReport,
+              MissClassifier &missClassifier, PolicyArguments... policyArguments) {
+    typedef SetAssociativeCache<ReplacementPolicy, PowerOfTwo> CacheType;
+    const int blockBytes = geometry.getBlockBytes();
+    // Allocate memory space for the cache
+    CacheType cache(geometry, policyArguments...);
+    // The same cache without prefetching, to tell which misses the prefetched blocks caused
+    CacheGeometry demandGeometry = geometry;
+    if (!Prefetcher::ENABLED) demandGeometry.cacheSize = 0;
+    CacheType demandCache(demandGeometry, policyArguments...);
+    PrefetchStatistics prefetchStatistics;
+    cache.setPrefetchLatency(PREFETCH_LATENCY);
+
+    // Counters
+    long long counter = 0, hitCounter = 0;
+    long long writeCounter = 0, writeBackCounter = 0, readBytes = 0, writtenBytes = 0;
+
+    // Count the memory traffic of a demand access or a prefetch
+    auto countTraffic = [&](int flags) {
+        if (flags & ACCESS_FILL) readBytes += blockBytes;
+        if (flags & ACCESS_WRITE_BACK) {
+            writeBackCounter++;
+            writtenBytes += blockBytes;
+        }
+        if (flags & ACCESS_WRITE_THROUGH) writtenBytes += 4;
+    };
+
+    // Log an access and count it
+    auto record = [&](uint64_t memoryAddress, bool write, int flags) {
+        bool hit = (flags & ACCESS_HIT) != 0;
+        if (hit) hitCounter++;
+        if (write) writeCounter++;
+        countTraffic(flags);
+        if (windowReport.isEnabled()) windowReport.record(hit);
+        if (missClassifier.isEnabled()) {
+            long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+            missClassifier.record(memoryBlockIndex, cache.getSetIndex(memoryBlockIndex), hit);
+        }
+        if (accessLog.printsAccesses()) {
+            long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+            accessLog.log(counter + 1, hit, memoryAddress, memoryBlockIndex, cache.getSetIndex(memoryBlockIndex),
+                          cache.getTag(memoryBlockIndex));
+        }
+        counter++;
+    };
+
+    if (threadCount > 1) {
+        // Split the sets over several threads, the accesses are still reported in trace order
+        ShardedSimulation<CacheType> simulation(cache, threadCount, writePolicy);
+        simulation.run(traceFile, [&](const std::vector<uint64_t> &addresses, const std::vector<unsigned char> &writes,
+                                      const std::vector<unsigned char> &results, long long) {
+            for (size_t i = 0; i < addresses.size(); i++) record(addresses[i], writes[i] != 0, results[i]);
+        });
+    } else {
+        // Read the trace data
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            // Get the memory block index in which the address is located
+            long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+            int setIndex = cache.getSetIndex(memoryBlockIndex);
+            long long tag = cache.getTag(memoryBlockIndex);
+            int flags = cache.access(setIndex, tag, counter, write, writePolicy);
+            if (Prefetcher::ENABLED) {
+                bool demandHit = demandCache.access(setIndex, tag, counter, write, writePolicy) & ACCESS_HIT;
+                prefetchStatistics.onAccess(flags, demandHit);
+                prefetcher.onAccess(memoryBlockIndex, flags, [&](long long prefetchBlockIndex) {
+                    if (prefetchBlockIndex < 0) return;
+                    int prefetchFlags = cache.prefetch(prefetchBlockIndex, counter);
+                    prefetchStatistics.onPrefetch(prefetchFlags);
+                    countTraffic(prefetchFlags);
+                });
+            }
+            record(memoryAddress, write, flags);
+        });
+    }
+    accessLog.flush();
+    if (windowReport.isEnabled()) {
+        windowReport.finish();
+        return;
+    }
+
+    std::cout << "\nTotal: " << counter << " / Hit: " << hitCounter << " / Miss: " << counter - hitCounter << std::endl;
+    std::cout << "MissRate: " << (double) (counter - hitCounter) / counter << std::endl;
+
+    if (missClassifier.isEnabled()) missClassifier.print();
+    if (Prefetcher::ENABLED) prefetchStatistics.print();
+
+    // Memory traffic is only interesting with writes, a non-default write policy or prefetching
+    if (writeCounter > 0 || !writePolicy.writeBack || !writePolicy.writeAllocate || Prefetcher::ENABLED) {
+        std::cout << "\nRead: " << counter - writeCounter << " / Write: " << writeCounter << std::endl;
+        std::cout << "WriteBacks: " << writeBackCounter << std::endl;
+        std::cout << "Memory: Read: " << readBytes << " Bytes / Written: " << writtenBytes << " Bytes" << std::endl;
+    }
+}
+
+// Simulate the trace through the Cache library (cache_model.h), then print the results
+// It covers the plain single-threaded runs: without prefetching, and with any replacement policy but the optimal one
+inline void simulateWithCache(const TraceFile &traceFile, const CacheGeometry &geometry, const std::string &policy,
+                              const WritePolicy &writePolicy, AccessLog &accessLog, WindowReport &windowReport,
+                              MissClassifier &missClassifier) {
+    Cache cache(geometry, policy, writePolicy);
+    std::vector<uint64_t> addresses;
+    std::vector<unsigned char> writes;
+    std::vector<uint64_t> hits(LIBRARY_BATCH_SIZE / 64);
+    addresses.reserve(LIBRARY_BATCH_SIZE);
+    writes.reserve(LIBRARY_BATCH_SIZE);
+    long long counter = 0;
+
+    // Run the collected accesses through the cache, then log and count each of them
+    auto flush = [&]() {
+        cache.accessBatch(addresses.data(), addresses.size(), hits.data(), writes.data());
+        for (size_t i = 0; i < addresses.size(); i++) {
+            bool hit = (hits[i / 64] >> (i % 64)) & 1;
+            if (windowReport.isEnabled()) windowReport.record(hit);
+            if (missClassifier.isEnabled()) {
+                missClassifier.record(cache.getMemoryBlockIndex(addresses[i]), cache.getSetIndex(addresses[i]), hit);
+            }
+            if (accessLog.printsAccesses()) {
+                accessLog.log(counter + 1, hit, addresses[i], cache.getMemoryBlockIndex(addresses[i]),
+                              cache.getSetIndex(addresses[i]), cache.getTag(addresses[i]));
+            }
+            counter++;
+        }
+        addresses.clear();
+        writes.clear();
+    };
+
+    traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+        addresses.push_back(memoryAddress);
+        writes.push_back(write);
+        if (addresses.size() == LIBRARY_BATCH_SIZE) flush();
+    });
+    flush();
+    accessLog.flush();
+    if (windowReport.isEnabled()) {
+        windowReport.finish();
+        return;
+    }
+
+    const CacheStatistics &statistics = cache.getStatistics();
+    std::cout << "\nTotal: " << statistics.accessCount << " / Hit: " << statistics.hitCount << " / Miss: "
+              << statistics.getMissCount() << std::endl;
+    std::cout << "MissRate: " << statistics.getMissRate() << std::endl;
+
+    if (missClassifier.isEnabled()) missClassifier.print();
+
+    // Memory traffic is only interesting with writes or a non-default write policy
+    if (statistics.writeCount > 0 || !writePolicy.writeBack || !writePolicy.writeAllocate) {
+        std::cout << "\nRead: " << statistics.accessCount - statistics.writeCount << " / Write: "
+                  << statistics.writeCount << std::endl;
+        std::cout << "WriteBacks: " << statistics.writeBackCount << std::endl;
+        std::cout << "Memory: Read: " << statistics.fetchedBytes << " Bytes / Written: " << statistics.writtenBytes
+                  << " Bytes" << std::endl;
+    }
+}
+
+// Simulate the trace through a hierarchy of caches (L1 -> L2 -> ...), then print the results of every level
+template<typename ReplacementPolicy>
+void simulateHierarchy(const TraceFile &traceFile, const std::vector<CacheGeometry> &geometries,
+                       const std::vector<int> &latencies, InclusionPolicy inclusionPolicy,
+                       const WritePolicy &writePolicy, AccessLog &accessLog) {
+    CacheHierarchy<ReplacementPolicy> hierarchy(geometries, latencies, inclusionPolicy, writePolicy);
+    // Only used to print the index and tag of L1
+    AddressMapping<false> l1Mapping(geometries[0]);
+
+    long long counter = 0;
+    traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+        bool hit = hierarchy.access(memoryAddress, counter, write) == 0;
+        if (accessLog.printsAccesses()) {
+            long long memoryBlockIndex = l1Mapping.getMemoryBlockIndex(memoryAddress);
+            accessLog.log(counter + 1, hit, memoryAddress, memoryBlockIndex, l1Mapping.getSetIndex(memoryBlockIndex),
+                          l1Mapping.getTag(memoryBlockIndex));
+        }
+        counter++;
+    });
+    accessLog.flush();
+
+    std::cout << "\nTotal: " << counter << std::endl;
+    hierarchy.printStatistics();
+}
+
+// Simulate one private cache per core, kept coherent with MESI, each core running its own trace
+template<typename ReplacementPolicy, bool PowerOfTwo>
+void simulateMulticore(const std::vector<std::string> &traceFilePaths, const CacheGeometry &geometry,
+                       int threadCount) {
+    MulticoreSimulation<ReplacementPolicy, PowerOfTwo> simulation(geometry, (int) traceFilePaths.size(), threadCount);
+    if (!simulation.load(traceFilePaths)) {
+        std::cerr << "Cannot open the trace file!" << std::endl;
+        exit(1);
+    }
+    simulation.run();
+    simulation.printStatistics();
+}
+
+// Simulate a sample of the trace and print the miss rate estimated for the whole trace:
+// with setSampleInterval > 0, only about one in setSampleInterval sets is simulated,
+// with period > 0, every period accesses warmup accesses are simulated unmeasured, then window accesses measured.
+// With validate, the full trace is simulated as well to check the estimate
+template<typename ReplacementPolicy, bool PowerOfTwo>
+void simulateSampled(const TraceFile &traceFile, const CacheGeometry &geometry, int setSampleInterval,
+                     long long period, long long window, long long warmup, const WritePolicy &writePolicy,
+                     bool validate) {
+    SetAssociativeCache<ReplacementPolicy, PowerOfTwo> cache(geometry);
+    MissRateEstimate estimate;
+    long long counter = 0;
+    long long populationSize;
+
+    if (setSampleInterval > 0) {
+        // Choose the sets by a hash of their index, so strided access patterns do not line up with the sample
+        int setCount = cache.getSetCount();
+        std::vector<unsigned char> sampledSets(setCount, 0);
+        for (int set = 0; set < setCount; set++) {
+            sampledSets[set] = hashAccess((uint64_t) set, 0x5E75) % (uint64_t) setSampleInterval == 0;
+        }
+        if (std::find(sampledSets.begin(), sampledSets.end(), 1) == sampledSets.end()) sampledSets[0] = 1;
+
+        std::vector<long long> setAccesses(setCount, 0), setMisses(setCount, 0);
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+            int setIndex = cache.getSetIndex(memoryBlockIndex);
+            if (sampledSets[setIndex]) {
+                int flags = cache.access(setIndex, cache.getTag(memoryBlockIndex), counter, write, writePolicy);
+                setAccesses[setIndex]++;
+                if (!(flags & ACCESS_HIT)) setMisses[setIndex]++;
+            }
+            counter++;
+        });
+        for (int set = 0; set < setCount; set++) {
+            if (sampledSets[set]) estimate.add(setAccesses[set], setMisses[set]);
+        }
+        populationSize = setCount;
+    } else {
+        // Accesses before the warm-up of each window are skipped, the cache keeps its state from the last window
+        long long windowAccesses = 0, windowMisses = 0;
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            long long position = counter % period;
+            if (position >= period - window - warmup) {
+                long long memoryBlockIndex = cache.getMemoryBlockIndex(memoryAddress);
+                int flags = cache.access(cache.getSetIndex(memoryBlockIndex), cache.getTag(memoryBlockIndex), counter,
+                                         write, writePolicy);
+                if (position >= period - window) {
+                    windowAccesses++;
+                    if (!(flags & ACCESS_HIT)) windowMisses++;
+                }
+                if (position == period - 1) {
+                    estimate.add(windowAccesses, windowMisses);
+                    windowAccesses = windowMisses = 0;
+                }
+            }
+            counter++;
+        });
+        if (windowAccesses > 0) estimate.add(windowAccesses, windowMisses);
+        // The windows are a sample of all the windows the trace could be cut into
+        populationSize = (counter + window - 1) / window;
+    }
+
+    std::cout << "\nTotal: " << counter << " / Measured: " << estimate.getAccessCount() << " / Hit: "
+              << estimate.getAccessCount() - estimate.getMissCount() << " / Miss: " << estimate.getMissCount()
+              << std::endl;
+    double halfWidth = estimate.getHalfWidth(populationSize);
+    std::cout << "MissRate: " << estimate.getMissRate() << " +- " << halfWidth << " (95% confidence, "
+              << estimate.getSampleCount() << " of " << populationSize
+              << (setSampleInterval > 0 ? " sets)" : " windows)") << std::endl;
+
+    if (validate) {
+        SetAssociativeCache<ReplacementPolicy, PowerOfTwo> fullCache(geometry);
+        long long missCounter = 0;
+        counter = 0;
+        traceFile.forEachAccess([&](uint64_t memoryAddress, bool write) {
+            long long memoryBlockIndex = fullCache.getMemoryBlockIndex(memoryAddress);
+            int flags = fullCache.access(fullCache.getSetIndex(memoryBlockIndex), fullCache.getTag(memoryBlockIndex),
+                                         counter, write, writePolicy);
+            if (!(flags & ACCESS_HIT)) missCounter++;
+            counter++;
+        });
+        double missRate = counter ? (double) missCounter / counter : 0.0;
+        double error = std::fabs(estimate.getMissRate() - missRate);
+        std::cout << "FullMissRate: " << missRate << " / Error: " << error << " / WithinInterval: "
+                  << (error <= halfWidth ? "Yes" : "No") << std::endl;
+    }
+}
+
+// Call run(prefetcher) with a prefetcher of the given name, fetching the given number of blocks ahead
+template<typename Run>
+void dispatchPrefetcher(const std::string &name, int degree, int blockSize, Run run) {
+    if (name == "next-line") {
+        NextLinePrefetcher prefetcher(degree);
+        run(prefetcher);
+    } else if (name == "stride") {
+        StridePrefetcher prefetcher(degree, blockSize);
+        run(prefetcher);
+    } else if (name == "stream") {
+        StreamPrefetcher prefetcher(degree);
+        run(prefetcher);
+    } else {
+        NoPrefetcher prefetcher;
+        run(prefetcher);
+    }
+}
+
+#endif //CACHE_SIMULATOR_SIMULATION_H
@@ -0,0 +1,114 @@
+#ifndef CACHE_SIMULATOR_SWEEP_H
+#define CACHE_SIMULATOR_SWEEP_H
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <map>
+
+// LRU stack-distance profile of a cache with a fixed number of sets
+// Every set keeps its blocks ordered from the most to the least recently used one, so an access found at depth d
+// would be a hit in any LRU cache with the same set count and a set degree larger than d
+class StackDistanceProfile {
+public:
+    StackDistanceProfile(int setCount, int maxDepth)
+            : setCount(setCount), maxDepth(maxDepth),
+              stacks((size_t) setCount * maxDepth), stackSizes(setCount, 0), hitsAtDepth(maxDepth, 0) {}
+
+    void access(long long memoryBlockIndex) {
+        long long *stack = &stacks[(size_t) (memoryBlockIndex % setCount) * maxDepth];
+        int &stackSize = stackSizes[memoryBlockIndex % setCount];
+
+        // Search the block from the top of the stack (MRU) to the bottom (LRU)
+        int depth = 0;
+        while (depth < stackSize && stack[depth] != memoryBlockIndex) depth++;
+        if (depth < stackSize) { // Hit at this depth
+            hitsAtDepth[depth]++;
+        } else if (stackSize < maxDepth) { // Miss -> push it on a stack which is not full yet
+            stackSize++;
+        } else { // Miss -> the bottom block falls out of the deepest cache we care about
+            depth = maxDepth - 1;
+        }
+
+        // Move the block to the top of the stack
+        for (int i = depth; i > 0; i--) stack[i] = stack[i - 1];
+        stack[0] = memoryBlockIndex;
+    }
+
+    // Return the number of hits of a cache with this set count and the given set degree
+    long long getHitCount(int setDegree) const {
+        long long hitCount = 0;
+        for (int i = 0; i < setDegree && i < maxDepth; i++) hitCount += hitsAtDepth[i];
+        return hitCount;
+    }
+
+private:
+    int setCount;
+    int maxDepth;
+    std::vector<long long> stacks;
+    std::vector<int> stackSizes;
+    std::vector<long long> hitsAtDepth;
+};
+
+// Simulate every LRU cache with a power-of-two size (KBytes) and set degree up to the given limits in one pass
+// Caches sharing the same set count are served by one stack-distance profile
+class CacheSweep {
+public:
+    CacheSweep(int maxCacheSize, int blockSize, int maxSetDegree) : blockSize(blockSize) {
+        for (int cacheSize = 1; cacheSize <= maxCacheSize; cacheSize *= 2) cacheSizes.push_back(cacheSize);
+        for (int setDegree = 1; setDegree <= maxSetDegree; setDegree *= 2) setDegrees.push_back(setDegree);
+
+        // Find the deepest set degree required by each set count
+        std::map<int, int> maxDepths;
+        for (int cacheSize: cacheSizes) {
+            for (int setDegree: setDegrees) {
+                int setCount = getSetCount(cacheSize, setDegree);
+                if (setCount <= 0) continue;
+                int &maxDepth = maxDepths[setCount];
+                if (setDegree > maxDepth) maxDepth = setDegree;
+            }
+        }
+        for (auto &i: maxDepths) profiles.emplace(i.first, StackDistanceProfile(i.first, i.second));
+    }
+
+    void access(long long memoryAddress) {
+        long long memoryBlockIndex = memoryAddress / (blockSize * 4);
+        for (auto &i: profiles) i.second.access(memoryBlockIndex);
+        counter++;
+    }
+
+    void printMissRateTable() const {
+        std::cout << "BlockSize: " << blockSize << " Words\nTotal: " << counter << std::endl << std::endl;
+        std::cout << "MissRate (rows: cache size in KBytes, columns: set degree)" << std::endl;
+        std::cout << std::setw(8) << "Size";
+        for (int setDegree: setDegrees) std::cout << std::setw(10) << std::to_string(setDegree) + "-way";
+        std::cout << std::endl;
+        for (int cacheSize: cacheSizes) {
+            std::cout << std::setw(8) << cacheSize;
+            for (int setDegree: setDegrees) {
+                int setCount = getSetCount(cacheSize, setDegree);
+                if (setCount <= 0 || counter == 0) { // The set degree is larger than the number of cache blocks
+                    std::cout << std::setw(10) << "-";
+                    continue;
+                }
+                long long hitCount = profiles.at(setCount).getHitCount(setDegree);
+                std::cout << std::setw(10) << (double) (counter - hitCount) / counter;
+            }
+            std::cout << std::endl;
+        }
+    }
+
+private:
+    int blockSize;
+    long long counter = 0;
+    std::vector<int> cacheSizes;
+    std::vector<int> setDegrees;
+    std::map<int, StackDistanceProfile> profiles;
+
+    // Same geometry as a single simulation run. note: 1024 stands for 'K'Byte, 4 stands for 1word = 4bytes
+    int getSetCount(int cacheSize, int setDegree) const {
+        return (cacheSize * 1024) / (blockSize * 4) / setDegree;
+    }
+};
+
+#endif //CACHE_SIMULATOR_SWEEP_H
@@ -0,0 +1,282 @@
+#ifndef CACHE_SIMULATOR_TRACE_H
+#define CACHE_SIMULATOR_TRACE_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+
+#ifdef _WIN32
+#include <iterator>
+#include <cstdio>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// Binary trace layout, all fields are little-endian:
+//   Offset  0: magic "CTRC"
+//   Offset  4: uint16 version (1 = addresses only, 2 = the highest bit of every record is set for writes)
+//   Offset  6: uint16 address width in bytes (4 or 8)
+//   Offset  8: uint64 number of records
+//   Offset 16: records, one fixed-width address each
+#define TRACE_MAGIC "CTRC"
+#define TRACE_VERSION 1
+#define TRACE_VERSION_READ_WRITE 2
+#define TRACE_HEADER_SIZE 16
+// The standard input is read in chunks of this size, so streams of any length use bounded memory
+#define TRACE_STREAM_CHUNK_SIZE (1 << 20)
+
+// Decode an unsigned little-endian integer of the given width (compiles to a plain load on little-endian hosts)
+template<int Width>
+inline uint64_t readLittleEndian(const unsigned char *bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < Width; i++) value |= (uint64_t) bytes[i] << (8 * i);
+    return value;
+}
+
+inline void writeLittleEndian(std::ostream &stream, uint64_t value, int width) {
+    char bytes[8];
+    for (int i = 0; i < width; i++) bytes[i] = (char) ((value >> (8 * i)) & 0xFF);
+    stream.write(bytes, width);
+}
+
+// A trace file mapped into memory, or the standard input read as a stream (path "-"). Both the text format
+// (one hexadecimal byte address per line) and the binary format above are accepted, the format is detected
+// by the magic number. A stream can only be read once, and a binary stream may have more records than its
+// header says (e.g. a count of 0 from a tracer which does not know it in advance): it is read up to the end
+class TraceFile {
+public:
+    TraceFile() = default;
+    TraceFile(const TraceFile &) = delete;
+    TraceFile &operator=(const TraceFile &) = delete;
+
+    ~TraceFile() {
+        close();
+    }
+
+    // Map the whole file into memory. Return false if it cannot be opened or the binary header is broken
+    bool open(const std::string &filepath) {
+        close();
+        if (filepath == "-") return openStream();
+#ifdef _WIN32
+        std::ifstream file(filepath, std::ios::in | std::ios::binary);
+        if (!file) return false;
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = (const unsigned char *) buffer.data();
+        size = buffer.size();
+#else
+        int fd = ::open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat status{};
+        if (fstat(fd, &status) != 0) {
+            ::close(fd);
+            return false;
+        }
+        size = (size_t) status.st_size;
+        if (size > 0) {
+            void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped == MAP_FAILED) {
+                ::close(fd);
+                return false;
+            }
+            madvise(mapped, size, MADV_SEQUENTIAL);
+            data = (const unsigned char *) mapped;
+        }
+        ::close(fd);
+#endif
+        if (!readHeader(data, size) || (binary && recordCount > (size - TRACE_HEADER_SIZE) / addressWidth)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        buffer.clear();
+#else
+        if (data != nullptr) munmap((void *) data, size);
+#endif
+        data = nullptr;
+        size = 0;
+        binary = false;
+        readWrite = false;
+        stream = false;
+        streamBuffer.clear();
+        streamUsed = 0;
+    }
+
+    bool isBinary() const {
+        return binary;
+    }
+
+    // Return if the trace is the standard input, which can only be read once
+    bool isStream() const {
+        return stream;
+    }
+
+    // Return if the records of a binary trace carry read/write flags
+    bool hasReadWriteFlags() const {
+        return readWrite;
+    }
+
+    // Call visit(address) for every byte address in the trace, in order
+    template<typename Visitor>
+    void forEachAddress(Visitor visit) const {
+        forEachAccess([&](uint64_t address, bool) { visit(address); });
+    }
+
+    // Call visit(address, write) for every access in the trace, in order
+    // A text line may start with R (read, the default) or W (write), e.g. "W 0x1586AB00"
+    template<typename Visitor>
+    void forEachAccess(Visitor visit) const {
+        if (stream) {
+            forEachStreamedAccess(visit);
+        } else if (binary) {
+            visitRecords(data + TRACE_HEADER_SIZE, recordCount, visit);
+        } else {
+            visitText(data, data + size, visit);
+        }
+    }
+
+private:
+    const unsigned char *data = nullptr;
+    size_t size = 0;
+    bool binary = false;
+    bool readWrite = false;
+    int addressWidth = 0;
+    uint64_t recordCount = 0;
+    bool stream = false;
+    // Reading a stream consumes it, even through a const trace
+    mutable std::vector<unsigned char> streamBuffer;
+    mutable size_t streamUsed = 0; // Bytes in the stream buffer which were read but not visited yet
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+
+    // Check the binary header at the start of the data, if there's one. Return false if it is broken
+    bool readHeader(const unsigned char *bytes, size_t length) {
+        binary = length >= TRACE_HEADER_SIZE && std::memcmp(bytes, TRACE_MAGIC, 4) == 0;
+        if (!binary) return true;
+        addressWidth = (int) readLittleEndian<2>(bytes + 6);
+        recordCount = readLittleEndian<8>(bytes + 8);
+        int version = (int) readLittleEndian<2>(bytes + 4);
+        readWrite = version == TRACE_VERSION_READ_WRITE;
+        return (version == TRACE_VERSION || readWrite) && (addressWidth == 4 || addressWidth == 8);
+    }
+
+    // Read the standard input up to the buffer size or the end. Return the number of bytes read, 0 at the end
+    static size_t readStream(unsigned char *bytes, size_t length) {
+#ifdef _WIN32
+        return std::fread(bytes, 1, length, stdin);
+#else
+        while (true) {
+            ssize_t count = ::read(0, bytes, length);
+            if (count >= 0) return (size_t) count;
+            if (errno != EINTR) return 0;
+        }
+#endif
+    }
+
+    // Start reading the standard input, and look for a binary header at its start
+    bool openStream() {
+#ifdef _WIN32
+        _setmode(_fileno(stdin), _O_BINARY);
+#endif
+        stream = true;
+        streamBuffer.resize(TRACE_STREAM_CHUNK_SIZE);
+        for (size_t count = 1; streamUsed < TRACE_HEADER_SIZE && count > 0; streamUsed += count) {
+            count = readStream(&streamBuffer[streamUsed], streamBuffer.size() - streamUsed);
+        }
+        if (!readHeader(streamBuffer.data(), streamUsed)) return false;
+        if (binary) {
+            std::memmove(streamBuffer.data(), streamBuffer.data() + TRACE_HEADER_SIZE, streamUsed - TRACE_HEADER_SIZE);
+            streamUsed -= TRACE_HEADER_SIZE;
+        }
+        return true;
+    }
+
+    // Visit the standard input chunk by chunk. Whatever is cut off at the end of a chunk (part of a line or
+    // a record) is moved to the front of the buffer and completed by the next chunk
+    template<typename Visitor>
+    void forEachStreamedAccess(Visitor &visit) const {
+        unsigned char *bytes = streamBuffer.data();
+        bool end = false;
+        while (!end) {
+            if (streamUsed < streamBuffer.size()) {
+                size_t count = readStream(bytes + streamUsed, streamBuffer.size() - streamUsed);
+                end = count == 0;
+                streamUsed += count;
+            }
+            size_t complete;
+            if (binary) {
+                complete = streamUsed - streamUsed % addressWidth;
+                visitRecords(bytes, complete / addressWidth, visit);
+            } else {
+                // Only whole lines, unless the stream ended or a line fills the whole buffer
+                complete = streamUsed;
+                while (!end && complete > 0 && bytes[complete - 1] != '\n') complete--;
+                if (complete == 0 && streamUsed == streamBuffer.size()) complete = streamUsed;
+                visitText(bytes, bytes + complete, visit);
+            }
+            std::memmove(bytes, bytes + complete, streamUsed - complete);
+            streamUsed -= complete;
+        }
+        streamUsed = 0;
+    }
+
+    template<typename Visitor>
+    void visitRecords(const unsigned char *record, uint64_t count, Visitor &visit) const {
+        if (addressWidth == 4) {
+            const uint64_t writeBit = readWrite ? 1ull << 31 : 0;
+            for (uint64_t i = 0; i < count; i++, record += 4) {
+                uint64_t value = readLittleEndian<4>(record);
+                visit(value & ~writeBit, (value & writeBit) != 0);
+            }
+        } else {
+            const uint64_t writeBit = readWrite ? 1ull << 63 : 0;
+            for (uint64_t i = 0; i < count; i++, record += 8) {
+                uint64_t value = readLittleEndian<8>(record);
+                visit(value & ~writeBit, (value & writeBit) != 0);
+            }
+        }
+    }
+
+    // Parse the text in place: skip blank lines, an optional R/W flag, an optional "0x" prefix,
+    // and trailing characters (e.g. '\r')
+    template<typename Visitor>
+    static void visitText(const unsigned char *p, const unsigned char *end, Visitor &visit) {
+        while (p < end) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+            if (p == end) break;
+            bool write = false;
+            if (*p == 'R' || *p == 'r' || *p == 'W' || *p == 'w') {
+                write = *p == 'W' || *p == 'w';
+                p++;
+                while (p < end && (*p == ' ' || *p == '\t' || *p == ',')) p++;
+            }
+            if (end - p >= 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) p += 2;
+            uint64_t address = 0;
+            for (int digit; p < end && (digit = hexDigitValue(*p)) >= 0; p++) address = (address << 4) | digit;
+            while (p < end && *p != '\n') p++;
+            visit(address, write);
+        }
+    }
+
+    static int hexDigitValue(unsigned char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+};
+
+#endif //CACHE_SIMULATOR_TRACE_H
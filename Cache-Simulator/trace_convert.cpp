@@ -0,0 +1,71 @@
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "trace.h"
+
+// Convert a text trace (one hexadecimal byte address per line) into the binary trace format
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        std::cerr << "Usage: TraceConverter text_trace_file binary_trace_file" << std::endl;
+        exit(1);
+    }
+
+    TraceFile textTrace;
+    if (!textTrace.open(argv[1])) {
+        std::cerr << "Cannot open the trace file!" << std::endl;
+        exit(1);
+    }
+    if (textTrace.isStream()) {
+        std::cerr << "The standard input cannot be converted, the converter reads the trace twice!" << std::endl;
+        exit(1);
+    }
+    if (textTrace.isBinary()) {
+        std::cerr << "The trace file is already in binary format!" << std::endl;
+        exit(1);
+    }
+
+    // First pass: count the records and pick the narrowest address width which fits all of them
+    // If the trace has any writes, the highest bit of every record is kept for the write flag
+    uint64_t recordCount = 0, maxAddress = 0;
+    bool hasWrites = false;
+    textTrace.forEachAccess([&](uint64_t address, bool write) {
+        recordCount++;
+        if (address > maxAddress) maxAddress = address;
+        if (write) hasWrites = true;
+    });
+    int addressWidth = maxAddress > (hasWrites ? 0x7FFFFFFFull : 0xFFFFFFFFull) ? 8 : 4;
+    if (hasWrites && maxAddress > 0x7FFFFFFFFFFFFFFFull) {
+        std::cerr << "Addresses of a read/write trace cannot use the highest bit!" << std::endl;
+        exit(1);
+    }
+    const uint64_t writeBit = 1ull << (addressWidth * 8 - 1);
+
+    // The write buffer has to be installed before the file is opened
+    std::vector<char> buffer(1 << 20);
+    std::ofstream binaryTrace;
+    binaryTrace.rdbuf()->pubsetbuf(buffer.data(), (std::streamsize) buffer.size());
+    binaryTrace.open(argv[2], std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!binaryTrace) {
+        std::cerr << "Cannot create the binary trace file!" << std::endl;
+        exit(1);
+    }
+
+    // Second pass: write the header and the records
+    binaryTrace.write(TRACE_MAGIC, 4);
+    writeLittleEndian(binaryTrace, hasWrites ? TRACE_VERSION_READ_WRITE : TRACE_VERSION, 2);
+    writeLittleEndian(binaryTrace, addressWidth, 2);
+    writeLittleEndian(binaryTrace, recordCount, 8);
+    textTrace.forEachAccess([&](uint64_t address, bool write) {
+        writeLittleEndian(binaryTrace, write ? address | writeBit : address, addressWidth);
+    });
+
+    binaryTrace.close();
+    if (!binaryTrace) {
+        std::cerr << "Failed to write the binary trace file!" << std::endl;
+        exit(1);
+    }
+    std::cout << "Converted " << recordCount << " addresses (" << addressWidth << " bytes each"
+              << (hasWrites ? ", with read/write flags" : "") << ")" << std::endl;
+    return 0;
+}
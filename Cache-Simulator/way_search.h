@@ -0,0 +1,150 @@
+#ifndef CACHE_SIMULATOR_WAY_SEARCH_H
+#define CACHE_SIMULATOR_WAY_SEARCH_H
+
+// Searches over the ways of one set, stored as separate arrays (64-bit tags, int valid flags and LRU times)
+// AVX2 is used when the compiler targets it (e.g. -mavx2), otherwise SSE2 on x86, otherwise plain loops.
+// Every search returns exactly what the scalar loops would, so results do not depend on the instruction set
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define WAY_SEARCH_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define WAY_SEARCH_SSE2
+#endif
+
+// Index of the highest / lowest bit which is set in a non-zero mask
+inline int highestBit(unsigned mask) {
+#if defined(__GNUC__)
+    return 31 - __builtin_clz(mask);
+#else
+    int index = 0;
+    while (mask >>= 1) index++;
+    return index;
+#endif
+}
+
+inline int lowestBit(unsigned mask) {
+#if defined(__GNUC__)
+    return __builtin_ctz(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Return the way holding a valid block with the (64-bit) tag, or -1 if there's none
+inline int findTag(const long long *tags, const int *valid, int setDegree, long long tag) {
+    int i = 0;
+#if defined(WAY_SEARCH_AVX2)
+    const __m256i key = _mm256_set1_epi64x(tag);
+    for (; i + 4 <= setDegree; i += 4) {
+        // Widen the 32-bit valid flags to 64-bit lanes (0 or -1 stays 0 or -1)
+        __m256i validLanes = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *) (valid + i)));
+        __m256i match = _mm256_and_si256(_mm256_cmpeq_epi64(_mm256_loadu_si256((const __m256i *) (tags + i)), key),
+                                         validLanes);
+        unsigned mask = (unsigned) _mm256_movemask_pd(_mm256_castsi256_pd(match));
+        if (mask) return i + lowestBit(mask);
+    }
+#elif defined(WAY_SEARCH_SSE2)
+    // SSE2 has no 64-bit compare, so both 32-bit halves of a lane must match
+    const __m128i key = _mm_set1_epi64x(tag);
+    for (; i + 2 <= setDegree; i += 2) {
+        __m128i halves = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (tags + i)), key);
+        __m128i equal = _mm_and_si128(halves, _mm_shuffle_epi32(halves, _MM_SHUFFLE(2, 3, 0, 1)));
+        __m128i validLanes = _mm_loadl_epi64((const __m128i *) (valid + i));
+        validLanes = _mm_unpacklo_epi32(validLanes, validLanes);
+        unsigned mask = (unsigned) _mm_movemask_pd(_mm_castsi128_pd(_mm_and_si128(equal, validLanes)));
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < setDegree; i++) {
+        if (valid[i] && tags[i] == tag) return i;
+    }
+    return -1;
+}
+
+// Return the first way without a valid block, or -1 if the set is full
+inline int findEmpty(const int *valid, int setDegree) {
+    int i = 0;
+#if defined(WAY_SEARCH_AVX2)
+    for (; i + 8 <= setDegree; i += 8) {
+        __m256i empty = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (valid + i)),
+                                           _mm256_setzero_si256());
+        unsigned mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(empty));
+        if (mask) return i + lowestBit(mask);
+    }
+#elif defined(WAY_SEARCH_SSE2)
+    for (; i + 4 <= setDegree; i += 4) {
+        __m128i empty = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (valid + i)), _mm_setzero_si128());
+        unsigned mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(empty));
+        if (mask) return i + lowestBit(mask);
+    }
+#endif
+    for (; i < setDegree; i++) {
+        if (!valid[i]) return i;
+    }
+    return -1;
+}
+
+// Return the way with the smallest time. On ties, the last way wins (same as scanning from the back with '<')
+inline int findOldest(const int *times, int setDegree) {
+    int i = 0;
+    int oldest = times[0];
+#if defined(WAY_SEARCH_AVX2)
+    if (setDegree >= 8) {
+        __m256i minimum = _mm256_loadu_si256((const __m256i *) times);
+        for (i = 8; i + 8 <= setDegree; i += 8) {
+            minimum = _mm256_min_epi32(minimum, _mm256_loadu_si256((const __m256i *) (times + i)));
+        }
+        __m128i half = _mm_min_epi32(_mm256_castsi256_si128(minimum), _mm256_extracti128_si256(minimum, 1));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_min_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        oldest = _mm_cvtsi128_si32(half);
+    }
+#elif defined(WAY_SEARCH_SSE2)
+    if (setDegree >= 4) {
+        // SSE2 has no 32-bit min, so select with a compare mask
+        __m128i minimum = _mm_loadu_si128((const __m128i *) times);
+        for (i = 4; i + 4 <= setDegree; i += 4) {
+            __m128i value = _mm_loadu_si128((const __m128i *) (times + i));
+            __m128i less = _mm_cmplt_epi32(value, minimum);
+            minimum = _mm_or_si128(_mm_and_si128(less, value), _mm_andnot_si128(less, minimum));
+        }
+        int lanes[4];
+        _mm_storeu_si128((__m128i *) lanes, minimum);
+        for (int lane: lanes) oldest = lane < oldest ? lane : oldest;
+    }
+#endif
+    for (; i < setDegree; i++) {
+        if (times[i] < oldest) oldest = times[i];
+    }
+
+    // Find the last way holding the smallest time
+    int way = setDegree - 1;
+#if defined(WAY_SEARCH_AVX2)
+    const __m256i key = _mm256_set1_epi32(oldest);
+    for (; way >= 7; way -= 8) {
+        __m256i match = _mm256_cmpeq_epi32(_mm256_loadu_si256((const __m256i *) (times + way - 7)), key);
+        unsigned mask = (unsigned) _mm256_movemask_ps(_mm256_castsi256_ps(match));
+        if (mask) return way - 7 + highestBit(mask);
+    }
+#elif defined(WAY_SEARCH_SSE2)
+    const __m128i key = _mm_set1_epi32(oldest);
+    for (; way >= 3; way -= 4) {
+        __m128i match = _mm_cmpeq_epi32(_mm_loadu_si128((const __m128i *) (times + way - 3)), key);
+        unsigned mask = (unsigned) _mm_movemask_ps(_mm_castsi128_ps(match));
+        if (mask) return way - 3 + highestBit(mask);
+    }
+#endif
+    for (; way >= 0; way--) {
+        if (times[way] == oldest) return way;
+    }
+    return setDegree - 1;
+}
+
+#endif //CACHE_SIMULATOR_WAY_SEARCH_H
@@ -0,0 +1,74 @@
+#ifndef CACHE_SIMULATOR_WINDOW_REPORT_H
+#define CACHE_SIMULATOR_WINDOW_REPORT_H
+
+#include <iostream>
+#include <string>
+
+// Reports the miss rate of every window of N accesses as soon as the window is complete, one line each,
+// so a long or endless stream can be watched while it runs. Only the counters of the current window are kept
+class WindowReport {
+public:
+    enum Format {
+        CSV,  // A header line, then "window,accesses,misses,miss_rate,total_accesses,total_miss_rate"
+        JSON, // One JSON object per line
+    };
+
+    // A window size of 0 disables the report
+    explicit WindowReport(long long windowSize = 0, Format format = CSV) : windowSize(windowSize), format(format) {}
+
+    // Parse a format: "csv" or "json". Return false if the format is incorrect
+    static bool parseFormat(const std::string &text, Format &format) {
+        if (text == "csv") {
+            format = CSV;
+        } else if (text == "json") {
+            format = JSON;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    bool isEnabled() const {
+        return windowSize > 0;
+    }
+
+    void record(bool hit) {
+        windowAccesses++;
+        if (!hit) windowMisses++;
+        if (windowAccesses == windowSize) emit();
+    }
+
+    // Report the last, incomplete window
+    void finish() {
+        if (windowAccesses > 0) emit();
+    }
+
+private:
+    long long windowSize;
+    Format format;
+    long long windowNumber = 0;
+    long long windowAccesses = 0;
+    long long windowMisses = 0;
+    long long totalAccesses = 0;
+    long long totalMisses = 0;
+
+    void emit() {
+        totalAccesses += windowAccesses;
+        totalMisses += windowMisses;
+        double missRate = (double) windowMisses / windowAccesses;
+        double totalMissRate = (double) totalMisses / totalAccesses;
+        if (format == CSV) {
+            if (windowNumber == 0) std::cout << "window,accesses,misses,miss_rate,total_accesses,total_miss_rate\n";
+            std::cout << windowNumber << "," << windowAccesses << "," << windowMisses << "," << missRate << ","
+                      << totalAccesses << "," << totalMissRate << std::endl;
+        } else {
+            std::cout << "{\"window\":" << windowNumber << ",\"accesses\":" << windowAccesses << ",\"misses\":"
+                      << windowMisses << ",\"missRate\":" << missRate << ",\"totalAccesses\":" << totalAccesses
+                      << ",\"totalMissRate\":" << totalMissRate << "}" << std::endl;
+        }
+        windowNumber++;
+        windowAccesses = windowMisses = 0;
+    }
+};
+
+#endif //CACHE_SIMULATOR_WINDOW_REPORT_H
@@ -0,0 +1,145 @@
+#ifndef TOMASULO_DATA_CACHE_H
+#define TOMASULO_DATA_CACHE_H
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+// Counters of the data cache
+struct DataCacheStatistics {
+    long long accessCount = 0;
+    long long hitCount = 0;
+    long long missCount = 0;       // Misses which fetched their block
+    long long mergedMissCount = 0; // Misses to a block already being fetched, which wait for the same fill
+    long long stalledCount = 0;    // Misses which had to wait for a free MSHR
+
+    double getMissRate() const {
+        return accessCount ? (double) (missCount + mergedMissCount) / accessCount : 0.0;
+    }
+};
+
+// A set-associative LRU data cache in front of the memory, which only decides the latency of the loads and stores.
+// Every miss holds an MSHR (miss status holding register) until its block arrives, and the misses to that block
+// in the meantime wait for the same fill. A miss finding no free MSHR cannot start
+class DataCache {
+public:
+    DataCacheStatistics statistics;
+
+    // A cache size of 0 disables the cache. An MSHR count of 0 allows any number of outstanding misses
+    DataCache(int cacheSize = 0, int blockSize = 1, int associativity = 1, int hitCycles = 1, int missCycles = 1,
+              int mshrCount = 0)
+            : blockSize(blockSize), associativity(associativity), hitCycles(hitCycles), missCycles(missCycles),
+              mshrs(mshrCount), unlimitedMshrs(mshrCount == 0) {
+        setCount = cacheSize / blockSize / associativity;
+        blocks.assign((size_t) setCount * associativity, Block());
+    }
+
+    bool isEnabled() const {
+        return setCount > 0;
+    }
+
+    // Access a byte address in a cycle. Return the latency of the access, or -1 if it is a miss without a free
+    // MSHR, in which case nothing changed
+    int access(long long address, int cycle) {
+        long long blockIndex = getBlockIndex(address);
+        const Mshr *mshr = findMshr(blockIndex, cycle);
+        if (mshr != nullptr) {
+            statistics.accessCount++;
+            statistics.mergedMissCount++;
+            return std::max(hitCycles, mshr->fillCycle - cycle + 1);
+        }
+
+        Block *set = &blocks[(size_t) getSetIndex(blockIndex) * associativity];
+        Block *victim = set;
+        for (int way = 0; way < associativity; way++) {
+            if (set[way].blockIndex == blockIndex) {
+                statistics.accessCount++;
+                statistics.hitCount++;
+                set[way].lastUsed = ++time;
+                return hitCycles;
+            }
+            if (set[way].lastUsed < victim->lastUsed) victim = &set[way];
+        }
+
+        Mshr *free = findFreeMshr(cycle);
+        if (free == nullptr) return -1;
+        free->blockIndex = blockIndex;
+        free->fillCycle = cycle + missCycles - 1;
+        statistics.accessCount++;
+        statistics.missCount++;
+        // The block takes its place right away, the accesses to it until the fill are merged into the MSHR
+        victim->blockIndex = blockIndex;
+        victim->lastUsed = ++time;
+        return missCycles;
+    }
+
+    // Return if an access to a byte address in a cycle would be a miss without a free MSHR
+    bool wouldStall(long long address, int cycle) const {
+        long long blockIndex = getBlockIndex(address);
+        if (unlimitedMshrs || findMshr(blockIndex, cycle) != nullptr) return false;
+        const Block *set = &blocks[(size_t) getSetIndex(blockIndex) * associativity];
+        for (int way = 0; way < associativity; way++) {
+            if (set[way].blockIndex == blockIndex) return false;
+        }
+        for (const Mshr &mshr: mshrs) {
+            if (mshr.fillCycle < cycle) return false;
+        }
+        return true;
+    }
+
+    // Return the first cycle in which an MSHR is free
+    int getNextFreeMshrCycle() const {
+        if (unlimitedMshrs) return 0;
+        int cycle = INT_MAX;
+        for (const Mshr &mshr: mshrs) cycle = std::min(cycle, mshr.fillCycle + 1);
+        return cycle;
+    }
+
+private:
+    struct Block {
+        long long blockIndex = -1;
+        long long lastUsed = 0;
+    };
+
+    // An outstanding miss: its block arrives at the end of the fill cycle, and the MSHR is free after it
+    struct Mshr {
+        long long blockIndex = -1;
+        int fillCycle = -1;
+    };
+
+    int blockSize;
+    int associativity;
+    int setCount;
+    int hitCycles;
+    int missCycles;
+    std::vector<Block> blocks; // The ways of set s at s * associativity ...
+    std::vector<Mshr> mshrs;
+    bool unlimitedMshrs;
+    long long time = 0;        // Counter of the accesses for LRU
+
+    long long getBlockIndex(long long address) const {
+        return address >= 0 ? address / blockSize : (address + 1) / blockSize - 1;
+    }
+
+    int getSetIndex(long long blockIndex) const {
+        return (int) (((blockIndex % setCount) + setCount) % setCount);
+    }
+
+    const Mshr *findMshr(long long blockIndex, int cycle) const {
+        for (const Mshr &mshr: mshrs) {
+            if (mshr.blockIndex == blockIndex && mshr.fillCycle >= cycle) return &mshr;
+        }
+        return nullptr;
+    }
+
+    Mshr *findFreeMshr(int cycle) {
+        for (Mshr &mshr: mshrs) {
+            if (mshr.fillCycle < cycle) return &mshr;
+        }
+        if (!unlimitedMshrs) return nullptr;
+        mshrs.emplace_back();
+        return &mshrs.back();
+    }
+};
+
+#endif //TOMASULO_DATA_CACHE_H
@@ -0,0 +1,55 @@
+#ifndef TOMASULO_FUNCTIONAL_UNITS_H
+#define TOMASULO_FUNCTIONAL_UNITS_H
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+// A pool of identical pipelined functional units shared by the RSs of one type
+// A unit starts at most one operation per cycle, and after starting one it waits for the initiation interval of
+// that operation before starting the next: 1 for a fully pipelined unit, the latency for a non-pipelined one
+class FunctionalUnitPool {
+public:
+    struct Unit {
+        int nextStartCycle = 0;    // First cycle in which the unit can start an operation
+        int busyUntil = 0;         // Last cycle of the operations in flight
+        long long operationCount = 0;
+        long long busyCycles = 0;  // Cycles with at least one operation in flight
+    };
+
+    std::vector<Unit> units;
+    long long waitCount = 0;       // Cycles the ready RSs spent waiting for a unit, summed over the RSs
+
+    void resize(int unitCount) {
+        units.assign(unitCount, Unit());
+    }
+
+    // Return the index of a unit which can start an operation in a cycle, or -1 if all of them are occupied
+    int findFreeUnit(int cycle) const {
+        for (int i = 0; i < (int) units.size(); i++) {
+            if (units[i].nextStartCycle <= cycle) return i;
+        }
+        return -1;
+    }
+
+    // Start an operation which executes in cycles cycle ... cycle + latency - 1
+    void start(int unit, int cycle, int latency, int interval) {
+        Unit &u = units[unit];
+        u.nextStartCycle = cycle + interval;
+        u.operationCount++;
+        int last = cycle + latency - 1;
+        if (last > u.busyUntil) {
+            u.busyCycles += last - std::max(u.busyUntil, cycle - 1);
+            u.busyUntil = last;
+        }
+    }
+
+    // Return the first cycle in which a unit can start an operation
+    int getNextStartCycle() const {
+        int cycle = INT_MAX;
+        for (auto &u: units) cycle = std::min(cycle, u.nextStartCycle);
+        return cycle;
+    }
+};
+
+#endif //TOMASULO_FUNCTIONAL_UNITS_H
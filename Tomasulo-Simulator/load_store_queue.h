@@ -0,0 +1,76 @@
+#ifndef TOMASULO_LOAD_STORE_QUEUE_H
+#define TOMASULO_LOAD_STORE_QUEUE_H
+
+#include <deque>
+#include <unordered_map>
+
+// The memory as doubles, the n-th at byte address 8n. Only the doubles which differ from the initial value are
+// stored, so the memory can be as large as the addresses
+class SparseMemory {
+public:
+    explicit SparseMemory(double initialValue = 0.0) : initialValue(initialValue) {}
+
+    double read(long long index) const {
+        auto i = values.find(index);
+        return i == values.end() ? initialValue : i->second;
+    }
+
+    void write(long long index, double value) {
+        values[index] = value;
+    }
+
+private:
+    double initialValue;
+    std::unordered_map<long long, double> values;
+};
+
+// The loads and stores in flight, in program order. An entry is added at issue and leaves as soon as its instruction
+// wrote its result and freed its RS, so the queue is never longer than the number of load and store buffers
+class LoadStoreQueue {
+public:
+    struct Entry {
+        int instructionIndex;
+        int station; // Index of the RS of the instruction
+        bool store;
+    };
+
+    void push(int instructionIndex, int station, bool store) {
+        entries.push_back({instructionIndex, station, store});
+    }
+
+    // Remove an instruction which wrote its result
+    void complete(int instructionIndex) {
+        for (auto i = entries.begin(); i != entries.end(); i++) {
+            if (i->instructionIndex == instructionIndex) {
+                entries.erase(i);
+                return;
+            }
+        }
+    }
+
+    // Return if a store older than an instruction did not write its result yet
+    bool hasOlderStore(int instructionIndex) const {
+        bool found = false;
+        forEachOlder(instructionIndex, [&](const Entry &entry) {
+            found = entry.store;
+            return !found;
+        });
+        return found;
+    }
+
+    // Call visit(entry) for the entries older than an instruction, the youngest first, until it
+    // returns false
+    template<typename Visit>
+    void forEachOlder(int instructionIndex, Visit visit) const {
+        auto i = entries.rbegin();
+        while (i != entries.rend() && i->instructionIndex >= instructionIndex) i++;
+        for (; i != entries.rend(); i++) {
+            if (!visit(*i)) return;
+        }
+    }
+
+private:
+    std::deque<Entry> entries;
+};
+
+#endif //TOMASULO_LOAD_STORE_QUEUE_H
@@ -0,0 +1,270 @@
+#ifndef TOMASULO_MACHINE_CONFIG_H
+#define TOMASULO_MACHINE_CONFIG_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <map>
+#include <cstdlib>
+
+// Default machine model, used for every key missing from the configuration file
+#define NUM_OF_INT_REGISTER 32
+// The number of floating-point registers (F0, F2, F4, ... , F30) is actually 16
+// But in order to call it without conversions (F[0], ... , F[30]), we set it to 30
+#define NUM_OF_FP_REGISTER 31
+// Every non-negative byte address, only the doubles written are stored
+#define SIZE_OF_MEMORY (1 << 28)
+
+#define NUM_OF_ADDER_RS 3
+#define NUM_OF_MULTIPLIER_RS 2
+#define NUM_OF_LOAD_BUFFER 2
+#define NUM_OF_STORE_BUFFER 2
+
+#define CYCLE_OF_LOAD 2
+#define CYCLE_OF_STORE 1
+#define CYCLE_OF_ADD 2
+#define CYCLE_OF_SUB 2
+#define CYCLE_OF_MUL 10
+#define CYCLE_OF_DIV 40
+
+// Initiation interval of every operation: 1 cycle, its functional unit is fully pipelined
+#define INTERVAL_OF_OPERATION 1
+// 0: one functional unit per RS
+#define NUM_OF_ADDER_UNIT 0
+#define NUM_OF_MULTIPLIER_UNIT 0
+#define NUM_OF_LOAD_UNIT 0
+#define NUM_OF_STORE_UNIT 0
+
+// Data cache in front of the memory, disabled by default (size 0): loads and stores take CYCLE_OF_LOAD and
+// CYCLE_OF_STORE cycles. With a cache, they take the hit or the miss cycles instead
+#define CACHE_SIZE 0
+#define CACHE_BLOCK_SIZE 64
+#define CACHE_ASSOCIATIVITY 4
+#define CYCLE_OF_CACHE_HIT 2
+#define CYCLE_OF_CACHE_MISS 20
+#define NUM_OF_MSHR 4
+
+#define ISSUE_WIDTH 1
+// 0: every result ready in a cycle is broadcast in that cycle
+#define NUM_OF_CDB 0
+
+// The machine model: number of RSs, functional units and cycles of every operation, issue width and CDBs,
+// registers, memory and their initial values
+struct MachineConfig {
+    int adderRS = NUM_OF_ADDER_RS;
+    int multiplierRS = NUM_OF_MULTIPLIER_RS;
+    int loadBuffers = NUM_OF_LOAD_BUFFER;
+    int storeBuffers = NUM_OF_STORE_BUFFER;
+
+    int loadCycles = CYCLE_OF_LOAD;
+    int storeCycles = CYCLE_OF_STORE;
+    int addCycles = CYCLE_OF_ADD;
+    int subCycles = CYCLE_OF_SUB;
+    int mulCycles = CYCLE_OF_MUL;
+    int divCycles = CYCLE_OF_DIV;
+
+    // Cycles after starting an operation before its functional unit can start the next one
+    int loadInterval = INTERVAL_OF_OPERATION;
+    int storeInterval = INTERVAL_OF_OPERATION;
+    int addInterval = INTERVAL_OF_OPERATION;
+    int subInterval = INTERVAL_OF_OPERATION;
+    int mulInterval = INTERVAL_OF_OPERATION;
+    int divInterval = INTERVAL_OF_OPERATION;
+
+    // Functional units shared by the RSs of every type, 0 for one per RS
+    int adderUnits = NUM_OF_ADDER_UNIT;
+    int multiplierUnits = NUM_OF_MULTIPLIER_UNIT;
+    int loadUnits = NUM_OF_LOAD_UNIT;
+    int storeUnits = NUM_OF_STORE_UNIT;
+    std::string selectPolicy = "oldest"; // Which ready RSs take the units first: oldest or latency
+
+    // 0: loads and stores write their results in program order
+    // 1: they only wait for the older ones with an unknown or the same address, loads take the values of stores
+    int disambiguation = 0;
+
+    int cacheSize = CACHE_SIZE;                   // In bytes, 0 for no cache
+    int cacheBlockSize = CACHE_BLOCK_SIZE;        // In bytes
+    int cacheAssociativity = CACHE_ASSOCIATIVITY; // LRU replacement
+    int cacheHitCycles = CYCLE_OF_CACHE_HIT;
+    int cacheMissCycles = CYCLE_OF_CACHE_MISS;
+    int mshrs = NUM_OF_MSHR;                      // Outstanding misses, 0 for unlimited
+
+    int issueWidth = ISSUE_WIDTH; // Instructions issued per cycle
+    int cdbs = NUM_OF_CDB;        // Results broadcast per cycle, 0 for unlimited
+
+    int intRegisters = NUM_OF_INT_REGISTER;
+    int fpRegisters = (NUM_OF_FP_REGISTER + 1) / 2; // F0, F2, ...
+    int memorySize = SIZE_OF_MEMORY;                // In doubles
+
+    double fpValue = 1.0;     // Initial value of every FP register
+    double memoryValue = 1.0; // Initial value of every double in the memory
+    // Initial values of single registers and doubles in the memory, overriding the values above
+    std::map<int, int> intRegisterValues = {{1, 16}};
+    std::map<int, double> fpRegisterValues;
+    std::map<int, double> memoryValues;
+
+    // Read "key = value" lines, '#' starts a comment:
+    //   adder_rs, multiplier_rs, load_buffers, store_buffers
+    //   load_cycles, store_cycles, add_cycles, sub_cycles, mul_cycles, div_cycles
+    //   load_interval, store_interval, add_interval, sub_interval, mul_interval, div_interval
+    //   adder_units, multiplier_units, load_units, store_units, select_policy
+    //   issue_width, cdbs, disambiguation
+    //   cache_size, cache_block_size, cache_associativity, cache_hit_cycles, cache_miss_cycles, mshrs
+    //   int_registers, fp_registers, memory_size, fp_value, memory_value
+    //   R<n>, F<n>, MEM<n>: initial value of a register or of the n-th double in the memory
+    void loadFromFile(const std::string &filepath) {
+        std::ifstream file(filepath);
+        if (!file.is_open()) {
+            std::cerr << "Failed to load the configuration file!" << std::endl;
+            exit(1);
+        }
+
+        const std::map<std::string, int MachineConfig::*> integers = {
+                {"adder_rs",            &MachineConfig::adderRS},
+                {"multiplier_rs",       &MachineConfig::multiplierRS},
+                {"load_buffers",        &MachineConfig::loadBuffers},
+                {"store_buffers",       &MachineConfig::storeBuffers},
+                {"load_cycles",         &MachineConfig::loadCycles},
+                {"store_cycles",        &MachineConfig::storeCycles},
+                {"add_cycles",          &MachineConfig::addCycles},
+                {"sub_cycles",          &MachineConfig::subCycles},
+                {"mul_cycles",          &MachineConfig::mulCycles},
+                {"div_cycles",          &MachineConfig::divCycles},
+                {"load_interval",       &MachineConfig::loadInterval},
+                {"store_interval",      &MachineConfig::storeInterval},
+                {"add_interval",        &MachineConfig::addInterval},
+                {"sub_interval",        &MachineConfig::subInterval},
+                {"mul_interval",        &MachineConfig::mulInterval},
+                {"div_interval",        &MachineConfig::divInterval},
+                {"adder_units",         &MachineConfig::adderUnits},
+                {"multiplier_units",    &MachineConfig::multiplierUnits},
+                {"load_units",          &MachineConfig::loadUnits},
+                {"store_units",         &MachineConfig::storeUnits},
+                {"issue_width",         &MachineConfig::issueWidth},
+                {"cdbs",                &MachineConfig::cdbs},
+                {"disambiguation",      &MachineConfig::disambiguation},
+                {"cache_size",          &MachineConfig::cacheSize},
+                {"cache_block_size",    &MachineConfig::cacheBlockSize},
+                {"cache_associativity", &MachineConfig::cacheAssociativity},
+                {"cache_hit_cycles",    &MachineConfig::cacheHitCycles},
+                {"cache_miss_cycles",   &MachineConfig::cacheMissCycles},
+                {"mshrs",               &MachineConfig::mshrs},
+                {"int_registers",       &MachineConfig::intRegisters},
+                {"fp_registers",        &MachineConfig::fpRegisters},
+                {"memory_size",         &MachineConfig::memorySize},
+        };
+
+        std::string line;
+        while (std::getline(file, line)) {
+            line = line.substr(0, line.find('#'));
+            size_t separator = line.find('=');
+            std::string key = trim(line.substr(0, separator));
+            if (key.empty() && separator == std::string::npos) continue;
+            if (separator == std::string::npos) fail("Configuration lines must be key = value: " + line);
+            std::string value = trim(line.substr(separator + 1));
+
+            if (integers.count(key)) {
+                this->*integers.at(key) = parseInteger(key, value);
+            } else if (key == "fp_value") {
+                fpValue = parseDouble(key, value);
+            } else if (key == "select_policy") {
+                selectPolicy = value;
+            } else if (key == "memory_value") {
+                memoryValue = parseDouble(key, value);
+            } else if (key.compare(0, 3, "MEM") == 0) {
+                memoryValues[parseIndex(key, 3)] = parseDouble(key, value);
+            } else if (key[0] == 'R') {
+                intRegisterValues[parseIndex(key, 1)] = parseInteger(key, value);
+            } else if (key[0] == 'F') {
+                fpRegisterValues[parseIndex(key, 1)] = parseDouble(key, value);
+            } else {
+                fail("Unknown configuration key: " + key);
+            }
+        }
+        validate();
+    }
+
+    // Exit with an error if the machine cannot be built
+    void validate() const {
+        for (int count: {adderRS, multiplierRS, loadBuffers, storeBuffers}) {
+            if (count <= 0) fail("Every type of RS needs at least one RS!");
+        }
+        for (int cycles: {loadCycles, storeCycles, addCycles, subCycles, mulCycles, divCycles}) {
+            if (cycles <= 0) fail("Every operation needs at least one cycle!");
+        }
+        for (int interval: {loadInterval, storeInterval, addInterval, subInterval, mulInterval, divInterval}) {
+            if (interval <= 0) fail("Every initiation interval must be at least one cycle!");
+        }
+        for (int count: {adderUnits, multiplierUnits, loadUnits, storeUnits}) {
+            if (count < 0) fail("The number of functional units cannot be negative!");
+        }
+        if (selectPolicy != "oldest" && selectPolicy != "latency") fail("The select policy must be oldest or latency!");
+        if (disambiguation != 0 && disambiguation != 1) fail("Disambiguation must be 0 or 1!");
+        if (cacheSize < 0) fail("The cache size cannot be negative!");
+        if (cacheSize > 0) {
+            if (cacheBlockSize <= 0 || cacheAssociativity <= 0) {
+                fail("The cache block size and associativity must be positive!");
+            }
+            if (cacheSize % ((long long) cacheBlockSize * cacheAssociativity) != 0) {
+                fail("The cache size must be a multiple of the block size times the associativity!");
+            }
+            if (cacheHitCycles <= 0 || cacheMissCycles < cacheHitCycles) {
+                fail("The cache hit cycles must be positive, and the miss cycles at least as many!");
+            }
+            if (mshrs < 0) fail("The number of MSHRs cannot be negative!");
+        }
+        if (issueWidth <= 0) fail("The issue width must be positive!");
+        if (cdbs < 0) fail("The number of CDBs cannot be negative!");
+        if (intRegisters <= 0 || fpRegisters <= 0 || memorySize <= 0) {
+            fail("The numbers of registers and the memory size must be positive!");
+        }
+        for (auto &i: intRegisterValues) {
+            if (i.first >= intRegisters) fail("R" + std::to_string(i.first) + " is out of range!");
+        }
+        for (auto &i: fpRegisterValues) {
+            if (i.first % 2 != 0 || i.first >= fpRegisters * 2) {
+                fail("F" + std::to_string(i.first) + " is out of range!");
+            }
+        }
+        for (auto &i: memoryValues) {
+            if (i.first >= memorySize) fail("MEM" + std::to_string(i.first) + " is out of range!");
+        }
+    }
+
+private:
+    [[noreturn]] static void fail(const std::string &message) {
+        std::cerr << message << std::endl;
+        exit(1);
+    }
+
+    static std::string trim(const std::string &text) {
+        size_t first = text.find_first_not_of(" \t\r");
+        if (first == std::string::npos) return "";
+        return text.substr(first, text.find_last_not_of(" \t\r") - first + 1);
+    }
+
+    static int parseInteger(const std::string &key, const std::string &value) {
+        char *end;
+        long number = std::strtol(value.c_str(), &end, 10);
+        if (value.empty() || *end != '\0') fail("Value of " + key + " must be an integer!");
+        return (int) number;
+    }
+
+    static double parseDouble(const std::string &key, const std::string &value) {
+        char *end;
+        double number = std::strtod(value.c_str(), &end);
+        if (value.empty() || *end != '\0') fail("Value of " + key + " must be a number!");
+        return number;
+    }
+
+    // Parse the index after the prefix of a key, e.g. 4 in F4
+    static int parseIndex(const std::string &key, size_t prefixLength) {
+        char *end;
+        const char *digits = key.c_str() + prefixLength;
+        long index = std::strtol(digits, &end, 10);
+        if (*digits == '\0' || *end != '\0' || index < 0) fail("Unknown configuration key: " + key);
+        return (int) index;
+    }
+};
+
+#endif //TOMASULO_MACHINE_CONFIG_H
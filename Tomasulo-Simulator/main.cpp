@@ -4,181 +4,266 @@
 #include <string>
 #include <iomanip>
 #include <algorithm>
-
-#define NUM_OF_INT_REGISTER 32
-// The number of floating-point registers (F0, F2, F4, ... , F30) is actually 16
-// But in order to call it without conversions (F[0], ... , F[30]), we set it to 30
-#define NUM_OF_FP_REGISTER 31
-#define SIZE_OF_MEMORY 8
-
-#define NUM_OF_ADDER_RS 3
-#define NUM_OF_MULTIPLIER_RS 2
-#define NUM_OF_LOAD_BUFFER 2
-#define NUM_OF_STORE_BUFFER 2
-
-#define CYCLE_OF_LOAD 2
-#define CYCLE_OF_STORE 1
-#define CYCLE_OF_ADD 2
-#define CYCLE_OF_SUB 2
-#define CYCLE_OF_MUL 10
-#define CYCLE_OF_DIV 40
-
+#include <climits>
+#include <cstdint>
+#include "machine_config.h"
+#include "functional_units.h"
+#include "load_store_queue.h"
+#include "data_cache.h"
+
+// Index of the lowest bit which is set in a non-zero mask
+inline int lowestBit(uint64_t mask) {
+#if defined(__GNUC__)
+    return __builtin_ctzll(mask);
+#else
+    int index = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
 
 class Tomasulo {
 public:
-    int R[NUM_OF_INT_REGISTER]{};
-    double F[NUM_OF_FP_REGISTER]{};
-    double MEM[SIZE_OF_MEMORY]{};
+    std::vector<int> R;
+    std::vector<double> F;
+    SparseMemory MEM;
 
-    Tomasulo() {
+    // All the storage is sized here from the machine model
+    explicit Tomasulo(const MachineConfig &config = MachineConfig()) : config(config) {
         // Initialize the value of registers and memory
-        for (int &i: R) i = 0;
-        for (double &i: F) i = 1.0;
-        for (double &i: MEM) i = 1.0;
-
-        // Set reservation station ID
-        for (int i = 0; i < NUM_OF_ADDER_RS; i++) {
-            RS[i].id.type = ReservationStationID::ADD;
-            RS[i].id.index = i;
+        R.assign(config.intRegisters, 0);
+        F.assign(config.fpRegisters * 2 - 1, config.fpValue);
+        MEM = SparseMemory(config.memoryValue);
+        for (auto &i: config.intRegisterValues) R[i.first] = i.second;
+        for (auto &i: config.fpRegisterValues) F[i.first] = i.second;
+        for (auto &i: config.memoryValues) MEM.write(i.first, i.second);
+        registerStat.resize(F.size());
+        issueCycles.assign(config.issueWidth + 1, 0);
+
+        // Set reservation station ID, the RSs of a type are contiguous
+        const std::pair<ReservationStationID::Type, int> stationCounts[] = {
+                {ReservationStationID::ADD,   config.adderRS},
+                {ReservationStationID::MULT,  config.multiplierRS},
+                {ReservationStationID::LOAD,  config.loadBuffers},
+                {ReservationStationID::STORE, config.storeBuffers},
+        };
+        for (auto &i: stationCounts) {
+            firstStation[i.first] = (int) RS.size();
+            for (int index = 0; index < i.second; index++) {
+                RS.emplace_back();
+                RS.back().id = ReservationStationID(i.first, index);
+            }
         }
-        for (int i = NUM_OF_ADDER_RS; i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS; i++) {
-            RS[i].id.type = ReservationStationID::MULT;
-            RS[i].id.index = i - NUM_OF_ADDER_RS;
+
+        if (config.cacheSize > 0) {
+            cache = DataCache(config.cacheSize, config.cacheBlockSize, config.cacheAssociativity,
+                              config.cacheHitCycles, config.cacheMissCycles, config.mshrs);
         }
-        for (int i = NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS;
-             i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER; i++) {
-            RS[i].id.type = ReservationStationID::LOAD;
-            RS[i].id.index = i - (NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS);
+
+        // A pool of functional units per type of RS, by default one unit per RS
+        for (auto &i: stationCounts) {
+            int unitCount = config.*UNIT_COUNTS[i.first];
+            unitPools[i.first].resize(unitCount > 0 ? unitCount : i.second);
         }
-        for (int i = NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER;
-             i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER + NUM_OF_STORE_BUFFER; i++) {
-            RS[i].id.type = ReservationStationID::STORE;
-            RS[i].id.index = i - (NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER);
+
+        // Every RS starts free, so an ID maps to its RS by an offset
+        for (auto &r: RS) {
+            std::vector<uint64_t> &freeBits = freeStations[r.id.type];
+            if (freeBits.size() <= (size_t) r.id.index / 64) freeBits.resize(r.id.index / 64 + 1, 0);
+            freeBits[r.id.index / 64] |= 1ull << (r.id.index % 64);
         }
     }
 
     // Run one clock cycle
     void runNextCycle() {
         clockCycle++;
+        stageEvents.clear();
+        // The RSs freed in the last cycle can be used again
+        for (int r: freedStations) freeStations[RS[r].id.type][RS[r].id.index / 64] |= 1ull << (RS[r].id.index % 64);
+        freedStations.clear();
         writeResult();
         execute();
         issue();
     }
 
+    // Skip the clock cycles in which the executing RSs only count down, then run the next cycle in which
+    // an instruction issues, completes its execution or writes its result. The results are the same as
+    // calling runNextCycle() for every cycle
+    void runUntilNextEvent() {
+        int skippedCycles = getNextEventCycle() - clockCycle - 1;
+        if (skippedCycles > 0) {
+            for (auto &r: RS) {
+                if (isExecuting(r)) r.cyclesRemaining -= skippedCycles;
+                if (isWaitingForUnit(r)) unitPools[r.id.type].waitCount += skippedCycles;
+            }
+            clockCycle += skippedCycles;
+            issueCycles[0] += skippedCycles;
+        }
+        runNextCycle();
+    }
+
     int getCurrentClockCycle() const {
         return clockCycle;
     }
 
     // Return if NOT all the result from instructions are written (writeResult > 0)
-    bool hasRemainingInstruction() {
-        return !std::all_of(instructions.begin(), instructions.end(),
-                            [](const Instruction &i) { return i.writeResult > 0; });
+    bool hasRemainingInstruction() const {
+        return writtenInstructionCount < (int) instructions.size();
     }
 
-    void printCurrentInstructionStatus() {
-        std::cout << "+-----------------------------------------+" << std::endl;
-        std::cout << std::left << "| " << std::setw(22) << "Instructions"
+    void printCurrentInstructionStatus(std::ostream &out) {
+        out << "+-----------------------------------------+" << '\n';
+        out << std::left << "| " << std::setw(22) << "Instructions"
                   << std::setw(6) << "Issue"
                   << std::setw(6) << "ExecC"
-                  << std::setw(6) << "Write" << "|" << std::endl;
-        std::cout << "+-----------------------------------------+" << std::endl;
+                  << std::setw(6) << "Write" << "|" << '\n';
+        out << "+-----------------------------------------+" << '\n';
         for (auto &i: instructions) {
-            std::cout << "| " << std::setw(7) << i.operation;
-            if (i.operation == "L.D" || i.operation == "S.D") {
-                std::cout << std::setw(5) << "F" + std::to_string(i.rt) + ",";
-                std::cout << std::setw(10) << std::to_string(i.imm) + "(R" + std::to_string(i.rs) + ")";
-            } else {
-                std::cout << std::setw(5) << "F" + std::to_string(i.rd) + ",";
-                std::cout << std::setw(5) << "F" + std::to_string(i.rs) + ",";
-                std::cout << std::setw(5) << "F" + std::to_string(i.rt);
-            }
-            std::cout << std::setw(6) << (i.issue > 0 ? std::to_string(i.issue) : "");
-            std::cout << std::setw(6) << (i.execComp > 0 ? std::to_string(i.execComp) : "");
-            std::cout << std::setw(6) << (i.writeResult > 0 ? std::to_string(i.writeResult) : "") << "|" << std::endl;
-        }
-        std::cout << "+-----------------------------------------+" << std::endl;
-    }
-
-    void printReservationStations() {
-        std::cout << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+" << std::endl;
-        std::cout << std::left << std::setw(9) << "| Name";
-        std::cout << std::setw(9) << "| Busy";
-        std::cout << std::setw(9) << "| Op";
-        std::cout << std::setw(9) << "| Vj";
-        std::cout << std::setw(9) << "| Vk";
-        std::cout << std::setw(9) << "| Qj";
-        std::cout << std::setw(9) << "| Qk";
-        std::cout << std::setw(9) << "| A";
-        std::cout << std::setw(9) << "| Time   |" << std::endl;
-        std::cout << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+" << std::endl;
+            out << "| ";
+            printInstruction(out, i);
+            out << std::setw(6) << (i.issue > 0 ? std::to_string(i.issue) : "");
+            out << std::setw(6) << (i.execComp > 0 ? std::to_string(i.execComp) : "");
+            out << std::setw(6) << (i.writeResult > 0 ? std::to_string(i.writeResult) : "") << "|" << '\n';
+        }
+        out << "+-----------------------------------------+" << '\n';
+    }
+
+    void printReservationStations(std::ostream &out) {
+        out << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+" << '\n';
+        out << std::left << std::setw(9) << "| Name";
+        out << std::setw(9) << "| Busy";
+        out << std::setw(9) << "| Op";
+        out << std::setw(9) << "| Vj";
+        out << std::setw(9) << "| Vk";
+        out << std::setw(9) << "| Qj";
+        out << std::setw(9) << "| Qk";
+        out << std::setw(9) << "| A";
+        out << std::setw(9) << "| Time   |" << '\n';
+        out << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+" << '\n';
         for (auto &i: RS) {
-            std::cout << "| " << std::left << std::setw(7) << i.id.toString();
-            std::cout << "| " << std::setw(7) << (i.busy ? "Yes" : "No");
+            out << "| " << std::left << std::setw(7) << i.id.toString();
+            out << "| " << std::setw(7) << (i.busy ? "Yes" : "No");
             if (i.busy) {
-                std::cout << "| " << std::setw(7) << instructions[i.instructionIndex].operation;
-                i.Qj.empty() ? std::cout << "| " << std::setw(7) << i.Vj : std::cout << "| " << std::setw(7) << "";
-                i.Qk.empty() ? std::cout << "| " << std::setw(7) << i.Vk : std::cout << "| " << std::setw(7) << "";
-                std::cout << "| " << std::setw(7) << i.Qj.toString();
-                std::cout << "| " << std::setw(7) << i.Qk.toString();
+                out << "| " << std::setw(7) << OPCODES[instructions[i.instructionIndex].opcode].name;
+                i.Qj.empty() ? out << "| " << std::setw(7) << i.Vj : out << "| " << std::setw(7) << "";
+                i.Qk.empty() ? out << "| " << std::setw(7) << i.Vk : out << "| " << std::setw(7) << "";
+                out << "| " << std::setw(7) << i.Qj.toString();
+                out << "| " << std::setw(7) << i.Qk.toString();
                 (i.id.type == ReservationStationID::LOAD || i.id.type == ReservationStationID::STORE) ?
-                std::cout << "| " << std::setw(7) << i.addr : std::cout << "| " << std::setw(7) << "";
-                std::cout << "| " << std::setw(7) << i.cyclesRemaining << "|" << std::endl;
+                out << "| " << std::setw(7) << i.addr : out << "| " << std::setw(7) << "";
+                out << "| " << std::setw(7) << i.cyclesRemaining << "|" << '\n';
             } else {
-                std::cout << "|        |        |        |        |        |        |        |" << std::endl;
+                out << "|        |        |        |        |        |        |        |" << '\n';
             }
-            std::cout << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+"
-                      << std::endl;
+            out << "+--------+--------+--------+--------+--------+--------+--------+--------+--------+"
+                      << '\n';
         }
     }
 
-    void printFloatingPointRegisters() {
-        for (int i = 0; i < NUM_OF_FP_REGISTER; i += 2) {
-            std::cout << "+--------";
+    void printFloatingPointRegisters(std::ostream &out) {
+        for (int i = 0; i < (int) F.size(); i += 2) {
+            out << "+--------";
         }
-        std::cout << "+" << std::endl;
-        for (int i = 0; i < NUM_OF_FP_REGISTER; i += 2) {
-            std::cout << "| " << std::setw(7) << "F" + std::to_string(i);
+        out << "+" << '\n';
+        for (int i = 0; i < (int) F.size(); i += 2) {
+            out << "| " << std::setw(7) << "F" + std::to_string(i);
         }
-        std::cout << "|" << std::endl;
-        for (int i = 0; i < NUM_OF_FP_REGISTER; i += 2) {
-            std::cout << "+--------";
+        out << "|" << '\n';
+        for (int i = 0; i < (int) F.size(); i += 2) {
+            out << "+--------";
         }
-        std::cout << "+" << std::endl;
-        for (int i = 0; i < NUM_OF_FP_REGISTER; i += 2) {
-            std::cout << "| " << std::setw(7) << registerStat[i].Qi.toString();
+        out << "+" << '\n';
+        for (int i = 0; i < (int) F.size(); i += 2) {
+            out << "| " << std::setw(7) << registerStat[i].Qi.toString();
         }
-        std::cout << "|" << std::endl;
-        for (int i = 0; i < NUM_OF_FP_REGISTER; i += 2) {
-            std::cout << "+--------";
+        out << "|" << '\n';
+        for (int i = 0; i < (int) F.size(); i += 2) {
+            out << "+--------";
         }
-        std::cout << "+" << std::endl;
+        out << "+" << '\n';
     }
 
-    void writeCurrentCycleOutputToFile(const std::string &filepath) {
-        std::fstream file;
+    // Print the full state of the current cycle: instructions, RSs and register status
+    void printCycle(std::ostream &out) {
+        out << "Clock Cycle: " << getCurrentClockCycle() << '\n';
+        printCurrentInstructionStatus(out);
+        printReservationStations(out);
+        printFloatingPointRegisters(out);
+        out << '\n';
+    }
 
-        if (clockCycle == 1) {
-            file.open(filepath, std::ios::out | std::ios::trunc);
-        } else {
-            file.open(filepath, std::ios::out | std::ios::app);
+    // Print only the stages reached in the current cycle, one line each, e.g. "Issue  ADD.D  F4,  F2,  F6   Add0"
+    // Nothing is printed for a cycle in which no stage was reached
+    void printCycleEvents(std::ostream &out) {
+        if (stageEvents.empty()) return;
+        out << "Clock Cycle: " << getCurrentClockCycle() << '\n';
+        for (auto &event: stageEvents) {
+            out << std::left << std::setw(7) << STAGE_NAMES[event.stage];
+            printInstruction(out, instructions[event.instructionIndex]);
+            out << event.station.toString() << '\n';
         }
+    }
 
-        if (!file.is_open()) {
-            std::cerr << "Failed to write output to file!" << std::endl;
-            exit(1);
+    // Write the stages reached in the current cycle as CSV lines: cycle,instruction,operation,stage,station
+    // The instructions are numbered from 0 in program order
+    void writeCycleEvents(std::ostream &out) {
+        for (auto &event: stageEvents) {
+            out << clockCycle << ',' << event.instructionIndex << ','
+                << OPCODES[instructions[event.instructionIndex].opcode].name << ','
+                << CSV_STAGE_NAMES[event.stage] << ',' << event.station.toString() << '\n';
         }
+    }
 
-        std::streambuf *coutbuf = std::cout.rdbuf();
-        std::cout.rdbuf(file.rdbuf());
+    // Print the utilization of the issue slots and the CDBs over the whole run
+    void printStatistics(std::ostream &out) const {
+        long long issueSlots = (long long) clockCycle * config.issueWidth;
+        out << "\nCycles: " << clockCycle << " / Instructions: " << instructions.size() << " / IPC: "
+            << (clockCycle ? (double) instructions.size() / clockCycle : 0.0) << '\n';
+        out << "IssueSlots: Width: " << config.issueWidth << " / Used: " << currentInstructionIndex << " of "
+            << issueSlots << " (" << (issueSlots ? (double) currentInstructionIndex / issueSlots : 0.0) << ")\n";
+        out << std::right << std::setw(10) << "Issued" << std::setw(10) << "Cycles" << '\n';
+        for (size_t i = 0; i < issueCycles.size(); i++) {
+            out << std::setw(10) << i << std::setw(10) << issueCycles[i] << '\n';
+        }
+        out << std::left;
 
-        std::cout << "Clock Cycle: " << getCurrentClockCycle() << std::endl;
-        printCurrentInstructionStatus();
-        printReservationStations();
-        printFloatingPointRegisters();
-        std::cout << std::endl;
+        out << "CDB: Buses: " << (config.cdbs > 0 ? std::to_string(config.cdbs) : "unlimited") << " / Broadcasts: "
+            << broadcastTotal;
+        if (config.cdbs > 0) {
+            long long busSlots = (long long) clockCycle * config.cdbs;
+            out << " of " << busSlots << " (" << (busSlots ? (double) broadcastTotal / busSlots : 0.0) << ")";
+        }
+        out << " / MaxPerCycle: " << maxBroadcastCount << " / Waits: " << busWaitCount << '\n';
+        out << "MemoryPort: Stores: " << storeCount << '\n';
+        out << "LSQ: Disambiguation: " << (config.disambiguation ? "on" : "off") << " / BypassingLoads: "
+            << bypassingLoadCount << " / ForwardedLoads: " << forwardedLoadCount << '\n';
+        if (cache.isEnabled()) {
+            const DataCacheStatistics &c = cache.statistics;
+            out << "Cache: Accesses: " << c.accessCount << " / Hits: " << c.hitCount << " / Misses: " << c.missCount
+                << " / MergedMisses: " << c.mergedMissCount << " / MissRate: " << c.getMissRate()
+                << " / StalledByMSHRs: " << c.stalledCount << '\n';
+        }
 
-        std::cout.rdbuf(coutbuf); // Reset to standard output
-        file.close();
+        out << "FunctionalUnits: Select: " << config.selectPolicy << '\n';
+        out << std::right << std::setw(14) << "Unit" << std::setw(12) << "Operations" << std::setw(12) << "BusyCycles"
+            << std::setw(12) << "Occupancy" << '\n';
+        for (int type = ReservationStationID::ADD; type < ReservationStationID::NUM_OF_TYPES; type++) {
+            const std::vector<FunctionalUnitPool::Unit> &units = unitPools[type].units;
+            for (size_t i = 0; i < units.size(); i++) {
+                out << std::setw(14) << UNIT_NAMES[type] + std::to_string(i) << std::setw(12)
+                    << units[i].operationCount << std::setw(12) << units[i].busyCycles << std::setw(12)
+                    << (clockCycle ? (double) units[i].busyCycles / clockCycle : 0.0) << '\n';
+            }
+        }
+        out << "Waits:";
+        for (int type = ReservationStationID::ADD; type < ReservationStationID::NUM_OF_TYPES; type++) {
+            out << (type == ReservationStationID::ADD ? " " : " / ") << UNIT_NAMES[type] << ": "
+                << unitPools[type].waitCount;
+        }
+        out << std::left << '\n';
     }
 
     void loadInstructionsFromFile(const std::string &filepath) {
@@ -202,10 +287,15 @@ public:
                 tokens.push_back(input.substr(beg, pos - beg));
             }
 
-            // Assign results from above to the instruction struct
+            if (tokens.empty()) continue;
+
+            // Decode the instruction once, the pipeline only looks at the opcode and its semantics
             Instruction instruction;
-            instruction.operation = tokens[0];
-            if (instruction.operation == "L.D" || instruction.operation == "S.D") {
+            instruction.opcode = decodeOpcode(tokens[0]);
+            instruction.unit = OPCODES[instruction.opcode].unit;
+            instruction.latency = config.*OPCODES[instruction.opcode].latency;
+            instruction.interval = config.*OPCODES[instruction.opcode].interval;
+            if (isMemoryInstruction(instruction)) {
                 instruction.rs = std::stoi(tokens[3].substr(1));
                 instruction.rt = std::stoi(tokens[1].substr(1));
                 instruction.imm = std::stoi(tokens[2]);
@@ -214,22 +304,21 @@ public:
                 instruction.rs = std::stoi(tokens[2].substr(1));
                 instruction.rt = std::stoi(tokens[3].substr(1));
             }
+            checkRegisters(instruction);
             instructions.push_back(instruction);
         }
         file.close();
     }
 
 private:
-    struct Instruction {
-        std::string operation;
-        int rd = 0;
-        int rs = 0;
-        int rt = 0;
-        int imm = 0;
-
-        int issue = 0;
-        int execComp = 0;
-        int writeResult = 0;
+    enum Opcode {
+        ADD_D,
+        SUB_D,
+        MUL_D,
+        DIV_D,
+        L_D,
+        S_D,
+        NUM_OF_OPCODES,
     };
 
     struct ReservationStationID {
@@ -239,6 +328,7 @@ private:
             MULT,
             LOAD,
             STORE,
+            NUM_OF_TYPES,
         } type;
         int index;
 
@@ -279,6 +369,49 @@ private:
         }
     };
 
+    // Semantics of an opcode: its name, the type of RS which executes it, and its number of cycles and initiation
+    // interval in the machine model
+    struct OpcodeInfo {
+        const char *name;
+        ReservationStationID::Type unit;
+        int MachineConfig::*latency;
+        int MachineConfig::*interval;
+    };
+
+    static constexpr OpcodeInfo OPCODES[NUM_OF_OPCODES] = {
+            {"ADD.D", ReservationStationID::ADD,   &MachineConfig::addCycles,   &MachineConfig::addInterval},
+            {"SUB.D", ReservationStationID::ADD,   &MachineConfig::subCycles,   &MachineConfig::subInterval},
+            {"MUL.D", ReservationStationID::MULT,  &MachineConfig::mulCycles,   &MachineConfig::mulInterval},
+            {"DIV.D", ReservationStationID::MULT,  &MachineConfig::divCycles,   &MachineConfig::divInterval},
+            {"L.D",   ReservationStationID::LOAD,  &MachineConfig::loadCycles,  &MachineConfig::loadInterval},
+            {"S.D",   ReservationStationID::STORE, &MachineConfig::storeCycles, &MachineConfig::storeInterval},
+    };
+
+    // The functional units of every type of RS: their number in the machine model and their name in the statistics
+    static constexpr int MachineConfig::*UNIT_COUNTS[ReservationStationID::NUM_OF_TYPES] = {
+            nullptr, &MachineConfig::adderUnits, &MachineConfig::multiplierUnits, &MachineConfig::loadUnits,
+            &MachineConfig::storeUnits,
+    };
+    static constexpr const char *UNIT_NAMES[ReservationStationID::NUM_OF_TYPES] = {
+            "", "Adder", "Multiplier", "Load", "Store",
+    };
+
+    // A decoded instruction and the clock cycles of its stages
+    struct Instruction {
+        Opcode opcode = ADD_D;
+        ReservationStationID::Type unit = ReservationStationID::ADD;
+        int latency = 0;
+        int interval = 1;
+        int rd = 0;
+        int rs = 0;
+        int rt = 0;
+        int imm = 0;
+
+        int issue = 0;
+        int execComp = 0;
+        int writeResult = 0;
+    };
+
     struct ReservationStation {
         ReservationStationID id;
         double Vj = 0.0;
@@ -292,30 +425,99 @@ private:
         // This value is updated when an RS finished its job (writeResult)
         // And other RSs which need its result must wait util next cycle (lastUsedCycle != clockCycle)
         int lastUsedCycle = 0;
-    } RS[NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER + NUM_OF_STORE_BUFFER];
+        // Registers waiting for the result of this RS
+        std::vector<int> dependentRegisters;
+        // Operands of other RSs waiting for the result of this RS: 2 * RS index for Qj, 2 * RS index + 1 for Qk
+        std::vector<int> dependentOperands;
+        // Set when the result won a CDB in this cycle
+        bool cdbGranted = false;
+        // Set when a functional unit started the operation, which then counts down every cycle
+        bool dispatched = false;
+        // Set when a load or store missed in the data cache without a free MSHR
+        bool stalledByCache = false;
+    };
+    std::vector<ReservationStation> RS;
+
+    FunctionalUnitPool unitPools[ReservationStationID::NUM_OF_TYPES];
+
+    LoadStoreQueue lsq;
+    DataCache cache;
+    // Results of findMemoryDependence() besides the index of a store
+    enum {
+        NO_MEMORY_DEPENDENCE = -1,
+        MEMORY_BLOCKED = -2,
+    };
+    std::vector<int> dispatchableStations; // RSs competing for the functional units in the current cycle
+
+    // Index of the first RS of every type
+    int firstStation[ReservationStationID::NUM_OF_TYPES]{};
+    // Free RSs of every type, bit i % 64 of word i / 64 for the RS with index i
+    std::vector<uint64_t> freeStations[ReservationStationID::NUM_OF_TYPES];
+    // RSs freed in the current cycle, which cannot be used until the next one
+    std::vector<int> freedStations;
 
     struct RegisterResultStatus {
         ReservationStationID Qi;
-    } registerStat[NUM_OF_FP_REGISTER];
+    };
+    std::vector<RegisterResultStatus> registerStat;
+
+    MachineConfig config;
 
     std::vector<Instruction> instructions;
     int clockCycle = 0; // Counter of clock cycles
     int currentInstructionIndex = 0; // Index to the instruction which is going to be issued
+    int writtenInstructionCount = 0; // Number of instructions which wrote their result
+
+    // Utilization of the issue slots and the CDBs
+    std::vector<long long> issueCycles; // Number of cycles in which 0, 1, ... , issueWidth instructions issued
+    std::vector<int> readyStations;     // RSs competing for the CDBs in the current cycle
+    long long broadcastTotal = 0;
+    long long busWaitCount = 0;         // Cycles a ready result waited for a CDB, summed over the results
+    int maxBroadcastCount = 0;          // Most results broadcast in one cycle
+    long long storeCount = 0;
+    long long bypassingLoadCount = 0;   // Loads which read the memory before an older store wrote it
+    long long forwardedLoadCount = 0;   // Loads which took the value of an older store
+
+    // The stages reached by the instructions in the current cycle, in the order they happened
+    enum Stage {
+        ISSUE,
+        EXECUTE_COMPLETE,
+        WRITE_RESULT,
+    };
+    static constexpr const char *STAGE_NAMES[] = {"Issue", "ExecC", "Write"};
+    static constexpr const char *CSV_STAGE_NAMES[] = {"issue", "execute", "write"};
 
+    struct StageEvent {
+        int instructionIndex;
+        Stage stage;
+        ReservationStationID station;
+    };
+    std::vector<StageEvent> stageEvents;
+
+    // Issue up to issueWidth instructions in program order, stopping at the first one which finds no free RS
     void issue() {
-        if (currentInstructionIndex >= instructions.size()) return;
+        int issuedCount = 0;
+        while (issuedCount < config.issueWidth && issueNextInstruction()) issuedCount++;
+        issueCycles[issuedCount]++;
+    }
+
+    // Issue the next instruction. Return false if there is none or it must wait for a free RS
+    bool issueNextInstruction() {
+        if (currentInstructionIndex >= (int) instructions.size()) return false;
         Instruction *instruction = &instructions[currentInstructionIndex];
-        if (instruction->operation == "ADD.D" || instruction->operation == "SUB.D") {
-            ReservationStationID rsId = findEmptyAdderRS();
+        int r;
+        if (instruction->unit == ReservationStationID::ADD) {
+            ReservationStationID rsId = findEmptyRS(ReservationStationID::ADD);
             // If no empty RS at the moment, wait until there's one
-            if (rsId.empty()) return;
-            int r = getReservationStationIndexByID(rsId);
+            if (rsId.empty()) return false;
+            r = takeReservationStation(rsId);
             RS[r].instructionIndex = currentInstructionIndex;
-            RS[r].cyclesRemaining = instruction->operation == "ADD.D" ? CYCLE_OF_ADD : CYCLE_OF_SUB;
+            RS[r].cyclesRemaining = instruction->latency;
             RS[r].busy = true;
 
             if (!registerStat[instruction->rs].Qi.empty()) {
                 RS[r].Qj = registerStat[instruction->rs].Qi;
+                RS[getReservationStationIndex(RS[r].Qj)].dependentOperands.push_back(2 * r);
             } else {
                 RS[r].Vj = F[instruction->rs];
                 RS[r].Qj.clear();
@@ -323,23 +525,26 @@ private:
 
             if (!registerStat[instruction->rt].Qi.empty()) {
                 RS[r].Qk = registerStat[instruction->rt].Qi;
+                RS[getReservationStationIndex(RS[r].Qk)].dependentOperands.push_back(2 * r + 1);
             } else {
                 RS[r].Vk = F[instruction->rt];
                 RS[r].Qk.clear();
             }
 
             registerStat[instruction->rd].Qi = rsId;
-        } else if (instruction->operation == "MUL.D" || instruction->operation == "DIV.D") {
-            ReservationStationID rsId = findEmptyMultiplierRS();
+            RS[r].dependentRegisters.push_back(instruction->rd);
+        } else if (instruction->unit == ReservationStationID::MULT) {
+            ReservationStationID rsId = findEmptyRS(ReservationStationID::MULT);
             // If no empty RS at the moment, wait until there's one
-            if (rsId.empty()) return;
-            int r = getReservationStationIndexByID(rsId);
+            if (rsId.empty()) return false;
+            r = takeReservationStation(rsId);
             RS[r].instructionIndex = currentInstructionIndex;
-            RS[r].cyclesRemaining = instruction->operation == "MUL.D" ? CYCLE_OF_MUL : CYCLE_OF_DIV;
+            RS[r].cyclesRemaining = instruction->latency;
             RS[r].busy = true;
 
             if (!registerStat[instruction->rs].Qi.empty()) {
                 RS[r].Qj = registerStat[instruction->rs].Qi;
+                RS[getReservationStationIndex(RS[r].Qj)].dependentOperands.push_back(2 * r);
             } else {
                 RS[r].Vj = F[instruction->rs];
                 RS[r].Qj.clear();
@@ -347,19 +552,22 @@ private:
 
             if (!registerStat[instruction->rt].Qi.empty()) {
                 RS[r].Qk = registerStat[instruction->rt].Qi;
+                RS[getReservationStationIndex(RS[r].Qk)].dependentOperands.push_back(2 * r + 1);
             } else {
                 RS[r].Vk = F[instruction->rt];
                 RS[r].Qk.clear();
             }
 
             registerStat[instruction->rd].Qi = rsId;
-        } else if (instruction->operation == "L.D") {
-            ReservationStationID rsId = findEmptyLoadBufferRS();
+            RS[r].dependentRegisters.push_back(instruction->rd);
+        } else if (instruction->unit == ReservationStationID::LOAD) {
+            ReservationStationID rsId = findEmptyRS(ReservationStationID::LOAD);
             // If no empty RS at the moment, wait until there's one
-            if (rsId.empty()) return;
-            int r = getReservationStationIndexByID(rsId);
+            if (rsId.empty()) return false;
+            r = takeReservationStation(rsId);
+            lsq.push(currentInstructionIndex, r, false);
             RS[r].instructionIndex = currentInstructionIndex;
-            RS[r].cyclesRemaining = CYCLE_OF_LOAD;
+            RS[r].cyclesRemaining = instruction->latency;
             RS[r].busy = true;
             RS[r].addr = instruction->imm;
 
@@ -368,13 +576,15 @@ private:
             RS[r].Qj.clear();
 
             registerStat[instruction->rt].Qi = rsId;
-        } else if (instruction->operation == "S.D") {
-            ReservationStationID rsId = findEmptyStoreBufferRS();
+            RS[r].dependentRegisters.push_back(instruction->rt);
+        } else { // STORE
+            ReservationStationID rsId = findEmptyRS(ReservationStationID::STORE);
             // If no empty RS at the moment, wait until there's one
-            if (rsId.empty()) return;
-            int r = getReservationStationIndexByID(rsId);
+            if (rsId.empty()) return false;
+            r = takeReservationStation(rsId);
+            lsq.push(currentInstructionIndex, r, true);
             RS[r].instructionIndex = currentInstructionIndex;
-            RS[r].cyclesRemaining = CYCLE_OF_STORE;
+            RS[r].cyclesRemaining = instruction->latency;
             RS[r].busy = true;
             RS[r].addr = instruction->imm;
 
@@ -384,6 +594,7 @@ private:
 
             if (!registerStat[instruction->rt].Qi.empty()) {
                 RS[r].Qk = registerStat[instruction->rt].Qi;
+                RS[getReservationStationIndex(RS[r].Qk)].dependentOperands.push_back(2 * r + 1);
             } else {
                 RS[r].Vk = F[instruction->rt];
                 RS[r].Qk.clear();
@@ -392,14 +603,56 @@ private:
 
         // Record the clock cycle of ISSUE stage of the instruction
         instruction->issue = clockCycle;
+        stageEvents.push_back({currentInstructionIndex, ISSUE, RS[r].id});
         currentInstructionIndex++;
+        return true;
+    }
+
+    // Start the operations of the RSs whose operands are ready on free functional units. When the units of a pool
+    // are all occupied, the select policy decides which RSs go first: the oldest instructions, or the longest
+    // operations (then the oldest)
+    void dispatch() {
+        dispatchableStations.clear();
+        for (int i = 0; i < (int) RS.size(); i++) {
+            if (isWaitingForUnit(RS[i]) && RS[i].lastUsedCycle != clockCycle) dispatchableStations.push_back(i);
+        }
+        bool byLatency = config.selectPolicy == "latency";
+        std::sort(dispatchableStations.begin(), dispatchableStations.end(), [&](int a, int b) {
+            if (byLatency && RS[a].cyclesRemaining != RS[b].cyclesRemaining) {
+                return RS[a].cyclesRemaining > RS[b].cyclesRemaining;
+            }
+            return RS[a].instructionIndex < RS[b].instructionIndex;
+        });
+
+        for (int r: dispatchableStations) {
+            FunctionalUnitPool &pool = unitPools[RS[r].id.type];
+            int unit = pool.findFreeUnit(clockCycle);
+            if (unit < 0) {
+                pool.waitCount++;
+                continue;
+            }
+            // With a data cache, the latency of a load or store is the one of its access
+            if (cache.isEnabled() && isMemoryInstruction(instructions[RS[r].instructionIndex])) {
+                int latency = cache.access(getEffectiveAddress(RS[r]), clockCycle);
+                if (latency < 0) {
+                    pool.waitCount++;
+                    if (!RS[r].stalledByCache) cache.statistics.stalledCount++;
+                    RS[r].stalledByCache = true;
+                    continue;
+                }
+                RS[r].cyclesRemaining = latency;
+            }
+            pool.start(unit, clockCycle, RS[r].cyclesRemaining, instructions[RS[r].instructionIndex].interval);
+            RS[r].dispatched = true;
+        }
     }
 
     void execute() {
+        dispatch();
         for (auto &r: RS) {
             if (r.id.type == ReservationStationID::LOAD || r.id.type == ReservationStationID::STORE) {
                 // For Load and Store operations, execute when RS[r].Oj = 0
-                if (r.busy && r.Qj.empty() && r.cyclesRemaining > 0) {
+                if (r.busy && r.dispatched && r.Qj.empty() && r.cyclesRemaining > 0) {
                     if (r.lastUsedCycle == clockCycle) {
                         continue;
                     }
@@ -408,18 +661,20 @@ private:
                         r.addr += (int) r.Vj;
                         // Record the clock cycle when EXECUTE stage of the instruction is complete
                         instructions[r.instructionIndex].execComp = clockCycle;
+                        stageEvents.push_back({r.instructionIndex, EXECUTE_COMPLETE, r.id});
                     }
                     r.cyclesRemaining--;
                 }
             } else {
                 // For other operations, execute when RS[r].Qj = 0 and RS[r].Qk = 0
-                if (r.busy && r.Qj.empty() && r.Qk.empty() && r.cyclesRemaining > 0) {
+                if (r.busy && r.dispatched && r.Qj.empty() && r.Qk.empty() && r.cyclesRemaining > 0) {
                     if (r.lastUsedCycle == clockCycle) {
                         continue;
                     }
                     if (r.cyclesRemaining == 1) {
                         // Record the clock cycle when EXECUTE stage of the instruction is complete
                         instructions[r.instructionIndex].execComp = clockCycle;
+                        stageEvents.push_back({r.instructionIndex, EXECUTE_COMPLETE, r.id});
                     }
                     r.cyclesRemaining--;
                 }
@@ -428,6 +683,9 @@ private:
     }
 
     void writeResult() {
+        arbitrateCommonDataBuses();
+        bool memoryPortUsed = false;
+        int broadcastCount = 0;
         for (auto &r: RS) {
             // When the execution of an instruction is complete
             if (r.busy && r.cyclesRemaining == 0) {
@@ -437,149 +695,362 @@ private:
                 if (r.id.type == ReservationStationID::STORE && (!r.Qk.empty() || r.lastUsedCycle == clockCycle)) {
                     continue;
                 }
-
-                // The load and store operations require in-order write-result
-                if (r.id.type == ReservationStationID::LOAD || r.id.type == ReservationStationID::STORE) {
-                    // Loop over instructions before this load-store command
-                    // to see if any load-store is unfinished (writeResult = 0)
-                    bool hasUnfinished = false;
-                    for (int i = r.instructionIndex - 1; i >= 0; i--) {
-                        if ((instructions[i].operation == "L.D" || instructions[i].operation == "S.D") &&
-                            instructions[i].writeResult == 0) {
-                            hasUnfinished = true;
-                        }
-                    }
-
-                    if (hasUnfinished) {
-                        continue;
-                    }
+                // Stores do not use a CDB, but only one of them writes the memory in a cycle
+                if (r.id.type == ReservationStationID::STORE && memoryPortUsed) continue;
+
+                // The load and store operations wait for the older ones they depend on
+                int forwardingStore = NO_MEMORY_DEPENDENCE;
+                if (isMemoryInstruction(instructions[r.instructionIndex])) {
+                    forwardingStore = findMemoryDependence(r, clockCycle);
+                    if (forwardingStore == MEMORY_BLOCKED) continue;
                 }
 
+                // Every other result is broadcast on a CDB
+                if (r.id.type != ReservationStationID::STORE && config.cdbs > 0 && !r.cdbGranted) continue;
+                r.cdbGranted = false;
+
                 // Record the clock cycle of WRITE-RESULT stage of the instruction
                 instructions[r.instructionIndex].writeResult = clockCycle;
+                stageEvents.push_back({r.instructionIndex, WRITE_RESULT, r.id});
+                writtenInstructionCount++;
                 r.busy = false;
+                freedStations.push_back(getReservationStationIndex(r.id));
 
                 // It's updated because if an instruction wants to use this RS must wait one cycle
                 // And will prevent problems in ISSUE stage
                 r.lastUsedCycle = clockCycle;
 
                 // Calculate the result
-                double result;
-                if (instructions[r.instructionIndex].operation == "ADD.D") {
-                    result = r.Vj + r.Vk;
-                } else if (instructions[r.instructionIndex].operation == "SUB.D") {
-                    result = r.Vj - r.Vk;
-                } else if (instructions[r.instructionIndex].operation == "MUL.D") {
-                    result = r.Vj * r.Vk;
-                } else if (instructions[r.instructionIndex].operation == "DIV.D") {
-                    result = r.Vj / r.Vk; // TODO: Remainder!
-                } else if (instructions[r.instructionIndex].operation == "L.D") {
-                    result = MEM[r.addr / 8];
-                } else if (instructions[r.instructionIndex].operation == "S.D") {
-                    MEM[r.addr / 8] = r.Vk;
-                    return;
+                double result = 0.0;
+                switch (instructions[r.instructionIndex].opcode) {
+                    case ADD_D:
+                        result = r.Vj + r.Vk;
+                        break;
+                    case SUB_D:
+                        result = r.Vj - r.Vk;
+                        break;
+                    case MUL_D:
+                        result = r.Vj * r.Vk;
+                        break;
+                    case DIV_D:
+                        result = r.Vj / r.Vk;
+                        break;
+                    case L_D:
+                        if (forwardingStore != NO_MEMORY_DEPENDENCE) {
+                            // Store-to-load forwarding: the value of the store, which is still to be written
+                            result = RS[forwardingStore].Vk;
+                            forwardedLoadCount++;
+                        } else {
+                            if (lsq.hasOlderStore(r.instructionIndex)) bypassingLoadCount++;
+                            result = MEM.read(getMemoryIndex(r.addr));
+                        }
+                        lsq.complete(r.instructionIndex);
+                        break;
+                    case S_D:
+                        lsq.complete(r.instructionIndex);
+                        MEM.write(getMemoryIndex(r.addr), r.Vk);
+                        memoryPortUsed = true;
+                        storeCount++;
+                        continue;
+                    default:
+                        break;
                 }
 
-                // Check if a register needs its result
-                for (int x = 0; x < NUM_OF_FP_REGISTER; x++) {
+                // Wake up the registers which still wait for its result (a later instruction may have renamed them)
+                for (int x: r.dependentRegisters) {
                     if (registerStat[x].Qi.equals(r.id)) {
                         F[x] = result;
                         registerStat[x].Qi.clear();
                     }
                 }
+                r.dependentRegisters.clear();
 
-                // Check if the Qj, Qk of an RS needs its result
-                for (auto &x: RS) {
-                    if (x.Qj.equals(r.id)) {
+                // Wake up the Qj, Qk of the RSs which need its result
+                for (int operand: r.dependentOperands) {
+                    ReservationStation &x = RS[operand / 2];
+                    if (operand % 2 == 0) {
                         x.Vj = result;
                         x.Qj.clear();
-                        x.lastUsedCycle = clockCycle;
-                    }
-
-                    if (x.Qk.equals(r.id)) {
+                    } else {
                         x.Vk = result;
                         x.Qk.clear();
-                        x.lastUsedCycle = clockCycle;
                     }
+                    x.lastUsedCycle = clockCycle;
                 }
+                r.dependentOperands.clear();
+                broadcastCount++;
             }
         }
+        broadcastTotal += broadcastCount;
+        maxBroadcastCount = std::max(maxBroadcastCount, broadcastCount);
     }
 
-    int getReservationStationIndexByID(ReservationStationID id) {
-        for (int i = 0; i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER + NUM_OF_STORE_BUFFER; i++) {
-            if (RS[i].id.equals(id)) return i;
+    // With a limited number of CDBs, the oldest results ready at the start of the cycle take the buses
+    // The others wait for a later cycle
+    void arbitrateCommonDataBuses() {
+        if (config.cdbs == 0) return;
+        readyStations.clear();
+        for (int i = 0; i < (int) RS.size(); i++) {
+            const ReservationStation &r = RS[i];
+            if (!r.busy || r.cyclesRemaining != 0 || r.id.type == ReservationStationID::STORE) continue;
+            if (r.id.type == ReservationStationID::LOAD && findMemoryDependence(r, clockCycle) == MEMORY_BLOCKED) {
+                continue;
+            }
+            readyStations.push_back(i);
         }
-        return -1;
+        if ((int) readyStations.size() > config.cdbs) {
+            std::partial_sort(readyStations.begin(), readyStations.begin() + config.cdbs, readyStations.end(),
+                              [&](int a, int b) { return RS[a].instructionIndex < RS[b].instructionIndex; });
+            busWaitCount += (int) readyStations.size() - config.cdbs;
+            readyStations.resize(config.cdbs);
+        }
+        for (int r: readyStations) RS[r].cdbGranted = true;
     }
 
-    ReservationStationID findEmptyAdderRS() {
-        for (int i = 0; i < NUM_OF_ADDER_RS; i++) {
-            if (RS[i].lastUsedCycle == clockCycle) {
-                continue;
+    // Decide if a load or store which completed its execution can write its result in a cycle, from the older
+    // loads and stores in the LSQ. Without disambiguation, it waits until all of them wrote their results.
+    // With disambiguation, it only waits for the older ones whose address is still unknown or is the same:
+    // a store waits for them all, and a load waits for stores only. A load whose youngest older store to the
+    // same address has its value takes that value instead of reading the memory
+    // Return MEMORY_BLOCKED, NO_MEMORY_DEPENDENCE, or the index of the store a load forwards the value from
+    int findMemoryDependence(const ReservationStation &r, int cycle) const {
+        bool store = r.id.type == ReservationStationID::STORE;
+        int dependence = NO_MEMORY_DEPENDENCE;
+        lsq.forEachOlder(r.instructionIndex, [&](const LoadStoreQueue::Entry &older) {
+            if (!config.disambiguation) {
+                dependence = MEMORY_BLOCKED;
+                return false;
             }
-            if (!RS[i].busy) {
-                return RS[i].id;
+            if (!store && !older.store) return true;
+            // The address of an instruction is known once it completed its execution
+            const ReservationStation &o = RS[older.station];
+            if (o.cyclesRemaining > 0) {
+                dependence = MEMORY_BLOCKED;
+                return false;
             }
-        }
-        return ReservationStationID();
+            if (o.addr / 8 != r.addr / 8) return true;
+            // Like the store itself, the load can use a value only in the cycle after it arrived
+            bool valueReady = !store && older.store && o.Qk.empty() && o.lastUsedCycle != cycle;
+            dependence = valueReady ? older.station : MEMORY_BLOCKED;
+            return false;
+        });
+        return dependence;
     }
 
-    ReservationStationID findEmptyMultiplierRS() {
-        for (int i = NUM_OF_ADDER_RS; i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS; i++) {
-            if (RS[i].lastUsedCycle == clockCycle) {
-                continue;
+    // Return if the operands of an RS are ready but its operation has not finished the EXECUTE stage
+    static bool hasReadyOperands(const ReservationStation &r) {
+        bool memory = r.id.type == ReservationStationID::LOAD || r.id.type == ReservationStationID::STORE;
+        return r.busy && r.cyclesRemaining > 0 && r.Qj.empty() && (memory || r.Qk.empty());
+    }
+
+    // Return if an RS counts down its cycles in the EXECUTE stage (a functional unit started its operation)
+    static bool isExecuting(const ReservationStation &r) {
+        return hasReadyOperands(r) && r.dispatched;
+    }
+
+    // Return if an RS waits for a functional unit to start its operation
+    static bool isWaitingForUnit(const ReservationStation &r) {
+        return hasReadyOperands(r) && !r.dispatched;
+    }
+
+    // Return the first clock cycle after the current one in which something else than a countdown happens:
+    // an instruction issues, a functional unit starts an operation, an RS completes its execution, or an RS writes
+    // its result
+    int getNextEventCycle() const {
+        if (currentInstructionIndex < (int) instructions.size()) {
+            ReservationStationID::Type unit = instructions[currentInstructionIndex].unit;
+            if (!findEmptyRS(unit).empty()) return clockCycle + 1;
+            for (int r: freedStations) {
+                if (RS[r].id.type == unit) return clockCycle + 1;
             }
-            if (!RS[i].busy) {
-                return RS[i].id;
+        }
+
+        int nextEventCycle = INT_MAX;
+        for (auto &r: RS) {
+            if (isExecuting(r)) {
+                nextEventCycle = std::min(nextEventCycle, clockCycle + r.cyclesRemaining);
+            } else if (isWaitingForUnit(r)) {
+                // Starting an operation is not a stage, but the cycles after it cannot be skipped either
+                int startCycle = std::max(clockCycle + 1, unitPools[r.id.type].getNextStartCycle());
+                if (cache.isEnabled() && isMemoryInstruction(instructions[r.instructionIndex]) &&
+                    cache.wouldStall(getEffectiveAddress(r), startCycle)) {
+                    startCycle = std::max(startCycle, cache.getNextFreeMshrCycle());
+                }
+                nextEventCycle = std::min(nextEventCycle, startCycle);
+            } else if (r.busy && r.cyclesRemaining == 0) {
+                // Waiting stores and loads are woken up by the result of another RS, which is an event itself
+                if (r.id.type == ReservationStationID::STORE && !r.Qk.empty()) continue;
+                if (isMemoryInstruction(instructions[r.instructionIndex]) &&
+                    findMemoryDependence(r, clockCycle + 1) == MEMORY_BLOCKED) {
+                    continue;
+                }
+                return clockCycle + 1;
             }
         }
-        return ReservationStationID();
+        return nextEventCycle == INT_MAX ? clockCycle + 1 : nextEventCycle;
     }
 
-    ReservationStationID findEmptyLoadBufferRS() {
-        for (int i = NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS;
-             i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER; i++) {
-            if (RS[i].lastUsedCycle == clockCycle) {
-                continue;
-            }
-            if (!RS[i].busy) {
-                return RS[i].id;
-            }
+    // Return the byte address a load or store accesses, which is only added to its address at the end of the
+    // EXECUTE stage
+    static long long getEffectiveAddress(const ReservationStation &r) {
+        return (long long) r.addr + (int) r.Vj;
+    }
+
+    // Return the index of the double at a byte address of the memory
+    long long getMemoryIndex(int addr) const {
+        if (addr < 0 || addr / 8 >= config.memorySize) {
+            std::cerr << "Memory address out of range: " << addr << std::endl;
+            exit(1);
         }
-        return ReservationStationID();
+        return addr / 8;
     }
 
-    ReservationStationID findEmptyStoreBufferRS() {
-        for (int i = NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER;
-             i < NUM_OF_ADDER_RS + NUM_OF_MULTIPLIER_RS + NUM_OF_LOAD_BUFFER + NUM_OF_STORE_BUFFER; i++) {
-            if (RS[i].lastUsedCycle == clockCycle) {
-                continue;
+    // Exit with an error if an instruction uses a register which does not exist
+    void checkRegisters(const Instruction &instruction) const {
+        bool memory = isMemoryInstruction(instruction);
+        int intRegister = memory ? instruction.rs : 0;
+        for (int fpRegister: {instruction.rd, memory ? 0 : instruction.rs, instruction.rt}) {
+            if (fpRegister < 0 || fpRegister >= (int) F.size()) {
+                std::cerr << "Register F" << fpRegister << " out of range!" << std::endl;
+                exit(1);
             }
-            if (!RS[i].busy) {
-                return RS[i].id;
+        }
+        if (intRegister < 0 || intRegister >= (int) R.size()) {
+            std::cerr << "Register R" << intRegister << " out of range!" << std::endl;
+            exit(1);
+        }
+    }
+
+    // Print an instruction in 22 columns, e.g. "L.D    F6,  8(R2)     "
+    static void printInstruction(std::ostream &out, const Instruction &i) {
+        out << std::left << std::setw(7) << OPCODES[i.opcode].name;
+        if (isMemoryInstruction(i)) {
+            out << std::setw(5) << "F" + std::to_string(i.rt) + ",";
+            out << std::setw(10) << std::to_string(i.imm) + "(R" + std::to_string(i.rs) + ")";
+        } else {
+            out << std::setw(5) << "F" + std::to_string(i.rd) + ",";
+            out << std::setw(5) << "F" + std::to_string(i.rs) + ",";
+            out << std::setw(5) << "F" + std::to_string(i.rt);
+        }
+    }
+
+    // Return the opcode of an instruction name, e.g. "ADD.D"
+    static Opcode decodeOpcode(const std::string &name) {
+        for (int i = 0; i < NUM_OF_OPCODES; i++) {
+            if (name == OPCODES[i].name) return (Opcode) i;
+        }
+        std::cerr << "Unknown instruction: " << name << std::endl;
+        exit(1);
+    }
+
+    // Return if an instruction is a load or a store
+    static bool isMemoryInstruction(const Instruction &instruction) {
+        return instruction.unit == ReservationStationID::LOAD || instruction.unit == ReservationStationID::STORE;
+    }
+
+    // Return the index of an RS in RS[] from its ID
+    int getReservationStationIndex(ReservationStationID id) const {
+        return firstStation[id.type] + id.index;
+    }
+
+    // Remove a free RS from the free RSs. Return its index in RS[]
+    int takeReservationStation(ReservationStationID id) {
+        freeStations[id.type][id.index / 64] &= ~(1ull << (id.index % 64));
+        int r = getReservationStationIndex(id);
+        RS[r].dispatched = false;
+        RS[r].stalledByCache = false;
+        return r;
+    }
+
+    // Return the ID of the first free RS of a type, or NONE if all of them are busy
+    // An RS freed in this cycle is not free until the next one
+    ReservationStationID findEmptyRS(ReservationStationID::Type type) const {
+        const std::vector<uint64_t> &freeBits = freeStations[type];
+        for (size_t word = 0; word < freeBits.size(); word++) {
+            if (freeBits[word] != 0) {
+                return RS[firstStation[type] + word * 64 + lowestBit(freeBits[word])].id;
             }
         }
         return ReservationStationID();
     }
 };
 
+constexpr Tomasulo::OpcodeInfo Tomasulo::OPCODES[];
+constexpr const char *Tomasulo::STAGE_NAMES[];
+constexpr const char *Tomasulo::CSV_STAGE_NAMES[];
+constexpr int MachineConfig::*Tomasulo::UNIT_COUNTS[];
+constexpr const char *Tomasulo::UNIT_NAMES[];
+
 int main(int argc, char **argv) {
-    if (argc != 2) {
+    // Tomasulo.exe input_file [--event-driven] [--config=FILE] [--output=LEVEL] [--events=FILE] [--stats]
+    if (argc < 2) {
         std::cerr << "Wrong arguments!" << std::endl;
         exit(1);
     }
+    bool eventDriven = false;
+    MachineConfig config;
+    std::string outputLevel = "full";
+    std::string eventLogPath;
+    bool statistics = false;
+    for (int i = 2; i < argc; i++) {
+        std::string argument = argv[i];
+        if (argument == "--event-driven") {
+            eventDriven = true;
+        } else if (argument.compare(0, 9, "--config=") == 0) {
+            config.loadFromFile(argument.substr(9));
+        } else if (argument.compare(0, 9, "--output=") == 0) {
+            outputLevel = argument.substr(9);
+            if (outputLevel != "full" && outputLevel != "delta" && outputLevel != "final") {
+                std::cerr << "Output level must be full, delta or final!" << std::endl;
+                exit(1);
+            }
+        } else if (argument.compare(0, 9, "--events=") == 0) {
+            eventLogPath = argument.substr(9);
+        } else if (argument == "--stats") {
+            statistics = true;
+        } else {
+            std::cerr << "Wrong arguments!" << std::endl;
+            exit(1);
+        }
+    }
 
-    Tomasulo tomasulo = Tomasulo();
-    tomasulo.R[1] = 16; // Set R1 to 16 as requested
+    Tomasulo tomasulo(config);
     tomasulo.loadInstructionsFromFile(argv[1]);
 
+    // The output files stay open for the whole run
+    std::ofstream output, eventLog;
+    if (outputLevel != "final") {
+        output.open("output.txt", std::ios::out | std::ios::trunc);
+        if (!output.is_open()) {
+            std::cerr << "Failed to write output to file!" << std::endl;
+            exit(1);
+        }
+    }
+    if (!eventLogPath.empty()) {
+        eventLog.open(eventLogPath, std::ios::out | std::ios::trunc);
+        if (!eventLog.is_open()) {
+            std::cerr << "Failed to write the event log!" << std::endl;
+            exit(1);
+        }
+        eventLog << "cycle,instruction,operation,stage,station\n";
+    }
+
     // Run until all the results are written
     while (tomasulo.hasRemainingInstruction()) {
-        tomasulo.runNextCycle();
-        tomasulo.writeCurrentCycleOutputToFile("output.txt");
+        if (eventDriven) {
+            tomasulo.runUntilNextEvent();
+        } else {
+            tomasulo.runNextCycle();
+        }
+        if (outputLevel == "full") {
+            tomasulo.printCycle(output);
+        } else if (outputLevel == "delta") {
+            tomasulo.printCycleEvents(output);
+        }
+        if (eventLog.is_open()) tomasulo.writeCycleEvents(eventLog);
     }
-    tomasulo.printCurrentInstructionStatus();
+    tomasulo.printCurrentInstructionStatus(std::cout);
+    if (statistics) tomasulo.printStatistics(std::cout);
 
     return 0;
 }